@@ -0,0 +1,146 @@
+#include "alloc_stats.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "tests.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+  struct thread_counters {
+    uint64_t count;
+    uint64_t bytes;
+    int64_t live;
+    int64_t peak_live;
+  };
+
+  thread_local constinit thread_counters g_counters{};
+
+}
+
+#if AOS_ALLOC_STATS
+
+namespace {
+
+  // Stored right before every block handed out, so that unsized deletes know what they free
+  struct block_header {
+    void* raw;
+    size_t size;
+  };
+
+  void* tracked_alloc(size_t size, size_t align) noexcept {
+    align = std::max(align, alignof(block_header));
+    auto* raw = static_cast<char*>(std::malloc(size + sizeof(block_header) + align - 1));
+    if (!raw) {
+      return nullptr;
+    }
+    auto user = (reinterpret_cast<uintptr_t>(raw) + sizeof(block_header) + align - 1) & ~(uintptr_t{ align } - 1);
+    auto* header = reinterpret_cast<block_header*>(user) - 1;
+    header->raw = raw;
+    header->size = size;
+
+    g_counters.count += 1;
+    g_counters.bytes += size;
+    g_counters.live += static_cast<int64_t>(size);
+    g_counters.peak_live = std::max(g_counters.peak_live, g_counters.live);
+    return reinterpret_cast<void*>(user);
+  }
+
+  void tracked_free(void* p) noexcept {
+    if (!p) {
+      return;
+    }
+    auto* header = static_cast<block_header*>(p) - 1;
+    g_counters.live -= static_cast<int64_t>(header->size);
+    std::free(header->raw);
+  }
+
+  void* tracked_new(size_t size, size_t align) {
+    if (void* p = tracked_alloc(size == 0 ? 1 : size, align)) {
+      return p;
+    }
+    throw std::bad_alloc();
+  }
+
+}
+
+// The default nothrow and array forms all forward to these
+void* operator new(size_t size) { return tracked_new(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new(size_t size, std::align_val_t align) { return tracked_new(size, static_cast<size_t>(align)); }
+void operator delete(void* p) noexcept { tracked_free(p); }
+void operator delete(void* p, size_t) noexcept { tracked_free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { tracked_free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { tracked_free(p); }
+
+#endif
+
+alloc_scope::alloc_scope()
+  : m_start{ g_counters.count, g_counters.bytes, 0 }
+  , m_start_live(g_counters.live)
+{
+  g_counters.peak_live = g_counters.live;
+}
+
+alloc_stats alloc_scope::stats() const {
+  return alloc_stats{
+    .count = g_counters.count - m_start.count,
+    .bytes = g_counters.bytes - m_start.bytes,
+    .peak_live = static_cast<uint64_t>(std::max<int64_t>(g_counters.peak_live - m_start_live, 0))
+  };
+}
+
+alloc_totals thread_alloc_totals() {
+  return { g_counters.count, g_counters.bytes, g_counters.live };
+}
+
+void add_thread_allocs(const alloc_totals& allocs) {
+  g_counters.count += allocs.count;
+  g_counters.bytes += allocs.bytes;
+  g_counters.live += allocs.live;
+  g_counters.peak_live = std::max(g_counters.peak_live, g_counters.live);
+}
+
+size_t peak_rss_bytes() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return 0;
+  }
+  return counters.PeakWorkingSetSize;
+#else
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#ifdef __APPLE__
+  return static_cast<size_t>(usage.ru_maxrss);
+#else
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+#if AOS_ALLOC_STATS
+#ifdef AOS_TESTS
+TEST(alloc_stats, scope) {
+  auto scope = alloc_scope();
+  {
+    auto v = std::vector<int>(1000);
+    auto w = std::vector<int>(1000);
+  }
+  auto v = std::vector<int>(500);
+  alloc_stats stats = scope.stats();
+  EXPECT_EQ(stats.count, 3);
+  EXPECT_EQ(stats.bytes, 2500 * sizeof(int));
+  EXPECT_EQ(stats.peak_live, 2000 * sizeof(int));
+}
+#endif
+#endif
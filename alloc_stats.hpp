@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Allocation accounting, only active in builds configured with AOS_ALLOC_STATS=ON,
+// where the global operator new/delete are replaced to feed it.
+// Counters are kept per thread, so concurrent days don't pollute each other's numbers.
+
+struct alloc_stats {
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+  // Highest amount of bytes allocated by the thread and not yet freed, relative to the scope start
+  uint64_t peak_live = 0;
+};
+
+constexpr bool alloc_stats_enabled() {
+#if AOS_ALLOC_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Records the allocations done by the current thread while it is alive, scopes must not be nested
+class alloc_scope {
+public:
+  alloc_scope();
+
+  alloc_stats stats() const;
+
+private:
+  alloc_stats m_start;
+  int64_t m_start_live;
+};
+
+// Allocations of the calling thread since it started, and the bytes of those still live, which other threads' frees
+// may make negative
+struct alloc_totals {
+  uint64_t count = 0;
+  uint64_t bytes = 0;
+  int64_t live = 0;
+};
+alloc_totals thread_alloc_totals();
+
+// Counts `allocs`, made by another thread on behalf of the calling one, as made by the calling one
+void add_thread_allocs(const alloc_totals& allocs);
+
+// High-water mark of the process resident set size, in bytes
+size_t peak_rss_bytes();
@@ -0,0 +1,189 @@
+#include "batch.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory_resource>
+#include <mutex>
+#include <sstream>
+#include "tests.hpp"
+
+namespace {
+
+  // Forwards to the default resource, counting the bytes that went through it
+  class counting_resource : public std::pmr::memory_resource {
+  public:
+    size_t allocated = 0;
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+      allocated += bytes;
+      return std::pmr::get_default_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+      std::pmr::get_default_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& r) const noexcept override {
+      return this == &r;
+    }
+  };
+
+  // Day memory of a worker, kept from input to input. The arena of an input starts in `buffer`,
+  // which then grows by what overflowed from it, so that inputs no larger than the previous ones allocate nothing
+  struct scratch_memory {
+    std::vector<std::byte> buffer;
+    counting_resource overflow;
+    // Where records are written before being sent to the results
+    std::ostringstream record;
+
+    void grow() {
+      if (overflow.allocated > 0) {
+        buffer = std::vector<std::byte>(buffer.size() + overflow.allocated);
+        overflow.allocated = 0;
+      }
+    }
+  };
+
+  thread_local scratch_memory t_scratch;
+
+  struct batch_input {
+    std::filesystem::path path;
+    size_t size;
+  };
+
+  // Writes the record of `input` to `out`, false when it could not be solved
+  bool solve_input(const day& d, const batch_input& input, std::optional<duration_ms> timeout, std::ostream& out) {
+    out << "{\"file\":";
+    write_json_string(out, input.path.filename().string());
+    out << ",\"bytes\":" << input.size;
+    auto file = mapped_file::open(input.path.string());
+    if (!file) {
+      out << ",\"error\":\"cannot open\"}\n";
+      return false;
+    }
+    try {
+      // A single arena for the model and the parts, they all go away with the input
+      auto arena = day_arena(t_scratch.buffer.data(), t_scratch.buffer.size(), &t_scratch.overflow);
+      const day_input model = d.prepare(file->view());
+      const day_part* parts[] = { &d.part1, &d.part2 };
+      for (size_t i = 0; i < std::size(parts) && *parts[i]; ++i) {
+        auto stop = std::stop_source();
+        auto timer = timeout ? std::optional<stop_timer>(std::in_place, stop, *timeout) : std::nullopt;
+        try {
+          auto result = (*parts[i])(model, stop.get_token());
+          out << ",\"part" << i + 1 << "\":";
+          write_json_string(out, result);
+        } catch (const day_cancelled& e) {
+          out << ",\"error\":";
+          write_json_string(out, "TIMEOUT in part " + std::to_string(i + 1) + ", " + e.what());
+          out << "}\n";
+          return false;
+        }
+      }
+    } catch (const std::exception& e) {
+      out << ",\"error\":";
+      write_json_string(out, e.what());
+      out << "}\n";
+      return false;
+    }
+    out << "}\n";
+    return true;
+  }
+}
+
+batch_summary run_batch(const day& d, const std::filesystem::path& directory, size_t workers, std::ostream& results,
+  std::optional<duration_ms> timeout) {
+  std::vector<batch_input> inputs;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    if (entry.is_regular_file()) {
+      inputs.push_back({ entry.path(), static_cast<size_t>(entry.file_size()) });
+    }
+  }
+  // Smallest first: each worker runs its share from the back, so the largest first, and thieves take the smallest
+  // inputs of a share, so that no long input is left to a single worker at the end
+  std::ranges::sort(inputs, [](const batch_input& l, const batch_input& r) {
+    return l.size != r.size ? l.size < r.size : l.path < r.path;
+  });
+
+  auto latencies = std::vector<duration_ms>(inputs.size());
+  auto failures = std::atomic<size_t>{ 0 };
+  std::mutex results_mutex;
+  auto start = std::chrono::steady_clock::now();
+  const size_t thread_count = std::clamp<size_t>(workers, 1, std::max<size_t>(inputs.size(), 1));
+  task_scheduler(thread_count).run(inputs.size(), [&](size_t i) {
+    auto input_start = std::chrono::steady_clock::now();
+    auto& record = t_scratch.record;
+    record.str({});
+    if (!solve_input(d, inputs[i], timeout, record)) {
+      ++failures;
+    }
+    t_scratch.grow();
+    latencies[i] = std::chrono::steady_clock::now() - input_start;
+    auto lock = std::lock_guard(results_mutex);
+    results << record.view() << std::flush;
+  });
+
+  auto sent = batch_summary{
+    .inputs = inputs.size(),
+    .failures = failures,
+    .workers = thread_count,
+    .wall = std::chrono::steady_clock::now() - start,
+    .latency = timing_stats::from_samples(std::move(latencies)),
+  };
+  for (const batch_input& input : inputs) {
+    sent.bytes += input.size;
+  }
+  return sent;
+}
+
+void print_batch_summary(std::ostream& out, const batch_summary& summary) {
+  double seconds = summary.wall.count() / 1000;
+  out << "Solved " << summary.inputs << " inputs (" << summary.bytes / 1e6 << "MB) on " << summary.workers << " workers"
+    << " in " << summary.wall.count() << "ms";
+  if (seconds > 0) {
+    out << ": " << summary.inputs / seconds << " inputs/s, " << summary.bytes / 1e6 / seconds << "MB/s";
+  }
+  if (summary.failures > 0) {
+    out << ", " << summary.failures << " FAILED";
+  }
+  out << '\n';
+  if (summary.inputs > 0) {
+    out << "  latency min " << summary.latency.min.count() << "ms"
+      << ", median " << summary.latency.median.count() << "ms"
+      << ", p90 " << summary.latency.p90.count() << "ms"
+      << ", p99 " << summary.latency.p99.count() << "ms"
+      << ", max " << summary.latency.max.count() << "ms\n";
+  }
+}
+
+#ifdef AOS_TESTS
+TEST(batch, run_batch) {
+  auto directory = std::filesystem::temp_directory_path() / "aos_batch_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  std::ofstream(directory / "small.txt") << "1000\n\n2000\n";
+  std::ofstream(directory / "large.txt") << "1000\n2000\n3000\n\n4000\n\n5000\n6000\n\n7000\n8000\n9000\n\n10000\n";
+  std::ofstream(directory / "bad.txt") << "not a number\n";
+
+  auto results = std::stringstream();
+  auto summary = run_batch(*find_day("d01"), directory, 2, results);
+  EXPECT_EQ(summary.inputs, 3);
+  EXPECT_EQ(summary.failures, 1);
+  EXPECT_EQ(summary.bytes, 11 + 55 + 13);
+  EXPECT_EQ(summary.latency.samples, 3);
+
+  auto lines = std::vector<std::string>{};
+  for (std::string line; std::getline(results, line);) {
+    lines.push_back(line);
+  }
+  std::ranges::sort(lines);
+  ASSERT_EQ(lines.size(), 3);
+  EXPECT_TRUE(lines[0].starts_with("{\"file\":\"bad.txt\",\"bytes\":13,\"error\":")) << lines[0];
+  EXPECT_EQ(lines[1], "{\"file\":\"large.txt\",\"bytes\":55,\"part1\":\"24000\",\"part2\":\"45000\"}");
+  EXPECT_EQ(lines[2], "{\"file\":\"small.txt\",\"bytes\":11,\"part1\":\"2000\",\"part2\":\"3000\"}");
+  std::filesystem::remove_all(directory);
+}
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "bench.hpp"
+#include "days.hpp"
+#include <filesystem>
+#include <iosfwd>
+#include <optional>
+
+struct batch_summary {
+  size_t inputs = 0;
+  size_t failures = 0;
+  size_t bytes = 0;
+  size_t workers = 0;
+  duration_ms wall{};
+  // Of every input, from opening it to its last part
+  timing_stats latency;
+};
+
+// Solves every part of `d` on every regular file of `directory` from `workers` threads. The files are sorted smallest
+// first and dealt to the workers in contiguous shares, each running its share from its largest file down.
+// Writes a JSON object per input to `results` as soon as it is solved, throws when `directory` cannot be listed.
+// Parts running longer than `timeout` are stopped at their next checkpoint, failing their input
+batch_summary run_batch(const day& d, const std::filesystem::path& directory, size_t workers, std::ostream& results,
+  std::optional<duration_ms> timeout = std::nullopt);
+
+void print_batch_summary(std::ostream& out, const batch_summary& summary);
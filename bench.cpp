@@ -0,0 +1,334 @@
+#include "bench.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <iomanip>
+#include <ostream>
+#include "tests.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+
+  // Spent by task_scheduler workers on the loops started by this thread
+  thread_local constinit int64_t t_borrowed_cpu_ns = 0;
+
+  int64_t own_cpu_ns() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    auto to_100ns = [](const FILETIME& t) { return (static_cast<int64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime; };
+    return (to_100ns(kernel) + to_100ns(user)) * 100;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return int64_t{ ts.tv_sec } * 1'000'000'000 + ts.tv_nsec;
+#endif
+  }
+
+  // The hooks are set before main, as aos_cli and aos_bench both link this
+  const bool g_usage_hooks_set = [] {
+    set_usage_hooks({
+      .read = [] {
+        const alloc_totals allocs = thread_alloc_totals();
+        return thread_usage{
+          .cpu_ns = own_cpu_ns() + t_borrowed_cpu_ns,
+          .alloc_count = allocs.count,
+          .alloc_bytes = allocs.bytes,
+          .live_bytes = allocs.live
+        };
+      },
+      .add = [](const thread_usage& usage) {
+        t_borrowed_cpu_ns += usage.cpu_ns;
+        add_thread_allocs({ .count = usage.alloc_count, .bytes = usage.alloc_bytes, .live = usage.live_bytes });
+      }
+    });
+    return true;
+  }();
+
+  // Nearest-rank percentile over sorted samples
+  duration_ms percentile(std::span<const duration_ms> sorted, double p) {
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+  }
+
+  template<typename Stage>
+  part_bench bench_stage(const day& d, int part_idx, Stage&& stage, const bench_options& options, perf_counters* counters) {
+    for (size_t i = 0; i < options.warmup; ++i) {
+      stage();
+    }
+    std::string result;
+    std::vector<duration_ms> samples;
+    samples.reserve(options.iterations);
+    std::optional<counter_values> total;
+    stage_metrics metrics;
+    for (size_t i = 0; i < options.iterations; ++i) {
+      result = measure_stage(metrics, counters, stage);
+      samples.push_back(metrics.wall);
+      if (metrics.counters) {
+        if (total) {
+          *total += *metrics.counters;
+        } else {
+          total = metrics.counters;
+        }
+      }
+    }
+    if (total) {
+      *total /= static_cast<double>(options.iterations);
+    }
+    return part_bench{
+      .day = d.name,
+      .part = part_idx,
+      .result = std::move(result),
+      .stats = timing_stats::from_samples(samples),
+      .samples = std::move(samples),
+      .counters = total
+    };
+  }
+
+  void write_json_counters(std::ostream& out, const counter_values& counters) {
+    for (hw_counter c : all_hw_counters) {
+      out << ",\"" << to_string(c) << "\":";
+      if (counters[c]) {
+        out << *counters[c];
+      } else {
+        out << "null";
+      }
+    }
+    if (auto ipc = counters.ipc()) {
+      out << ",\"ipc\":" << *ipc;
+    }
+    if (auto rate = counters.cache_miss_rate()) {
+      out << ",\"cache_miss_rate\":" << *rate;
+    }
+    if (auto mpki = counters.branch_mpki()) {
+      out << ",\"branch_mpki\":" << *mpki;
+    }
+  }
+
+  void print_text(std::ostream& out, std::span<const part_bench> results, const bench_options& options) {
+    if (results.empty()) {
+      return;
+    }
+    out << "Benchmarking " << results.front().day << " (" << options.iterations << " iterations, " << options.warmup << " warmup):\n";
+    for (const part_bench& r : results) {
+      if (r.part == 0) {
+        out << "Parse:\n";
+      } else {
+        out << "Part " << r.part << ": " << r.result << '\n';
+      }
+      out << "  min " << r.stats.min.count() << "ms"
+        << ", median " << r.stats.median.count() << "ms"
+        << ", p90 " << r.stats.p90.count() << "ms"
+        << ", p99 " << r.stats.p99.count() << "ms"
+        << ", max " << r.stats.max.count() << "ms\n";
+      if (r.counters) {
+        print_counters(out, *r.counters);
+      }
+    }
+  }
+
+  // One object per line, so that results of several runs can simply be concatenated
+  void print_json(std::ostream& out, std::span<const part_bench> results, const bench_options& options) {
+    for (const part_bench& r : results) {
+      out << "{\"day\":";
+      write_json_string(out, r.day);
+      out << ",\"part\":" << r.part
+        << ",\"iterations\":" << r.stats.samples
+        << ",\"warmup\":" << options.warmup
+        << ",\"min_ms\":" << r.stats.min.count()
+        << ",\"median_ms\":" << r.stats.median.count()
+        << ",\"p90_ms\":" << r.stats.p90.count()
+        << ",\"p99_ms\":" << r.stats.p99.count()
+        << ",\"max_ms\":" << r.stats.max.count()
+        << ",\"mean_ms\":" << r.stats.mean.count();
+      if (r.counters) {
+        write_json_counters(out, *r.counters);
+      }
+      out << ",\"result\":";
+      write_json_string(out, r.result);
+      out << "}\n";
+    }
+  }
+
+  // Results are left out as they may span several lines (d10)
+  void print_csv(std::ostream& out, std::span<const part_bench> results, const bench_options& options) {
+    bool counters = std::ranges::any_of(results, [](const part_bench& r) { return r.counters.has_value(); });
+    out << "day,part,iterations,warmup,min_ms,median_ms,p90_ms,p99_ms,max_ms,mean_ms";
+    if (counters) {
+      for (hw_counter c : all_hw_counters) {
+        out << ',' << to_string(c);
+      }
+    }
+    out << '\n';
+    for (const part_bench& r : results) {
+      out << r.day << ',' << r.part << ',' << r.stats.samples << ',' << options.warmup
+        << ',' << r.stats.min.count()
+        << ',' << r.stats.median.count()
+        << ',' << r.stats.p90.count()
+        << ',' << r.stats.p99.count()
+        << ',' << r.stats.max.count()
+        << ',' << r.stats.mean.count();
+      if (counters) {
+        for (hw_counter c : all_hw_counters) {
+          out << ',';
+          if (r.counters && (*r.counters)[c]) {
+            out << *(*r.counters)[c];
+          }
+        }
+      }
+      out << '\n';
+    }
+  }
+}
+
+void write_json_string(std::ostream& out, std::string_view s) {
+  out << '"';
+  for (char c : s) {
+    switch (c) {
+    case '"': out << "\\\""; break;
+    case '\\': out << "\\\\"; break;
+    case '\n': out << "\\n"; break;
+    case '\r': out << "\\r"; break;
+    case '\t': out << "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+      } else {
+        out << c;
+      }
+    }
+  }
+  out << '"';
+}
+
+duration_ms thread_cpu_time() {
+  return std::chrono::nanoseconds(own_cpu_ns() + t_borrowed_cpu_ns);
+}
+
+stop_timer::stop_timer(std::stop_source stop, duration_ms timeout)
+  : m_thread([stop, timeout](std::stop_token cancelled) mutable {
+      std::mutex mutex;
+      std::condition_variable_any wake;
+      auto lock = std::unique_lock(mutex);
+      // Returns early when the timer is destroyed
+      wake.wait_for(lock, cancelled, timeout, [] { return false; });
+      if (!cancelled.stop_requested()) {
+        stop.request_stop();
+      }
+    })
+{}
+
+void print_alloc_stats(std::ostream& out, const stage_metrics& metrics) {
+  if constexpr (alloc_stats_enabled()) {
+    out << "  allocated " << metrics.allocs.count << " blocks, " << metrics.allocs.bytes << " bytes"
+      << ", peak live " << metrics.allocs.peak_live << " bytes"
+      << ", peak RSS " << peak_rss_bytes() / 1024 << "KB\n";
+  }
+}
+
+timing_stats timing_stats::from_samples(std::vector<duration_ms> samples) {
+  timing_stats sent;
+  sent.samples = samples.size();
+  if (samples.empty()) {
+    return sent;
+  }
+  std::ranges::sort(samples);
+  sent.min = samples.front();
+  sent.median = percentile(samples, 50);
+  sent.p90 = percentile(samples, 90);
+  sent.p99 = percentile(samples, 99);
+  sent.max = samples.back();
+  for (const duration_ms& s : samples) {
+    sent.mean += s;
+  }
+  sent.mean /= static_cast<double>(samples.size());
+  return sent;
+}
+
+std::vector<part_bench> bench_day(const day& d, std::string_view raw, const bench_options& options, perf_counters* counters) {
+  std::vector<part_bench> sent;
+  if (!d.part1) {
+    return sent;
+  }
+  if (d.parse) {
+    sent.push_back(bench_stage(d, 0, [&]() { auto arena = day_arena(); d.parse(raw); return std::string{}; }, options, counters));
+  }
+  // The model lives in `model_arena`, every run gets a fresh arena whose release is timed with it
+  auto model_arena = day_arena();
+  const day_input input = d.prepare(raw);
+  sent.push_back(bench_stage(d, 1, [&]() { auto arena = day_arena(); return d.part1(input); }, options, counters));
+  if (d.part2) {
+    sent.push_back(bench_stage(d, 2, [&]() { auto arena = day_arena(); return d.part2(input); }, options, counters));
+  }
+  return sent;
+}
+
+void print_bench_report(std::ostream& out, std::span<const part_bench> results, const bench_options& options) {
+  switch (options.format) {
+  case report_format::text: print_text(out, results, options); break;
+  case report_format::json: print_json(out, results, options); break;
+  case report_format::csv: print_csv(out, results, options); break;
+  }
+}
+
+#ifdef AOS_TESTS
+TEST(bench, stats) {
+  auto samples = std::vector<duration_ms>{};
+  for (int i = 100; i > 0; --i) {
+    samples.push_back(duration_ms{ static_cast<double>(i) });
+  }
+  auto stats = timing_stats::from_samples(std::move(samples));
+  EXPECT_EQ(stats.samples, 100);
+  EXPECT_EQ(stats.min.count(), 1);
+  EXPECT_EQ(stats.median.count(), 50);
+  EXPECT_EQ(stats.p90.count(), 90);
+  EXPECT_EQ(stats.p99.count(), 99);
+  EXPECT_EQ(stats.max.count(), 100);
+  EXPECT_EQ(stats.mean.count(), 50.5);
+}
+
+TEST(bench, stop_timer) {
+  auto expired = std::stop_source();
+  {
+    auto timer = stop_timer(expired, duration_ms{ 1 });
+    while (!expired.stop_requested()) {
+      std::this_thread::yield();
+    }
+  }
+  auto destroyed = std::stop_source();
+  {
+    auto timer = stop_timer(destroyed, std::chrono::hours{ 1 });
+  }
+  EXPECT_FALSE(destroyed.stop_requested());
+}
+
+TEST(bench, parallel_usage) {
+  // Each chunk spins on its own thread clock, wherever it runs the start thread is charged with all of them
+  auto scheduler = task_scheduler(3);
+  const auto start = thread_cpu_time();
+  const auto allocs = alloc_scope();
+  scheduler.run(6, [](size_t) {
+    auto v = std::vector<int>(100);
+    for (auto begin = own_cpu_ns(); own_cpu_ns() - begin < 5'000'000;) {}
+  });
+  EXPECT_GE((thread_cpu_time() - start).count(), 30);
+  if constexpr (alloc_stats_enabled()) {
+    EXPECT_EQ(allocs.stats().count, 6);
+  }
+}
+
+TEST(bench, single_sample) {
+  auto stats = timing_stats::from_samples({ duration_ms{ 3 } });
+  EXPECT_EQ(stats.min.count(), 3);
+  EXPECT_EQ(stats.p99.count(), 3);
+  EXPECT_EQ(stats.max.count(), 3);
+}
+#endif
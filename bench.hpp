@@ -0,0 +1,104 @@
+#pragma once
+
+#include "days.hpp"
+#include "alloc_stats.hpp"
+#include "perf_counters.hpp"
+#include <chrono>
+#include <iosfwd>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using duration_ms = std::chrono::duration<double, std::milli>;
+
+// CPU time consumed so far by the calling thread, and by the task_scheduler workers running its parallel loops
+duration_ms thread_cpu_time();
+
+// Requests a stop of `stop` once `timeout` elapsed, unless destroyed before. It waits on a thread of its own,
+// so that the part it bounds keeps running on the measured thread
+class stop_timer {
+public:
+  stop_timer(std::stop_source stop, duration_ms timeout);
+
+private:
+  std::jthread m_thread;
+};
+
+// What is recorded around a single run of a parse stage or a part
+struct stage_metrics {
+  duration_ms wall{};
+  alloc_stats allocs;
+  // Only when measured with available hardware counters
+  std::optional<counter_values> counters;
+};
+
+// Counters are started before and stopped after the clock is read, to keep their ioctls out of the wall time
+template<typename F>
+auto measure_stage(stage_metrics& metrics, perf_counters* counters, F&& f) {
+  auto allocs = alloc_scope();
+  if (counters) {
+    counters->start();
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto sent = f();
+  auto end = std::chrono::steady_clock::now();
+  if (counters && counters->available()) {
+    metrics.counters = counters->stop();
+  } else {
+    metrics.counters = std::nullopt;
+  }
+  metrics.allocs = allocs.stats();
+  metrics.wall = end - start;
+  return sent;
+}
+
+template<typename F>
+auto measure_stage(stage_metrics& metrics, F&& f) {
+  return measure_stage(metrics, nullptr, std::forward<F>(f));
+}
+
+// Prints the allocation line following a stage in run output, only in AOS_ALLOC_STATS builds
+void print_alloc_stats(std::ostream& out, const stage_metrics& metrics);
+
+struct timing_stats {
+  size_t samples = 0;
+  duration_ms min{}, median{}, p90{}, p99{}, max{}, mean{};
+
+  static timing_stats from_samples(std::vector<duration_ms> samples);
+};
+
+enum class report_format {
+  text, json, csv
+};
+
+struct bench_options {
+  size_t iterations = 100;
+  size_t warmup = 5;
+  report_format format = report_format::text;
+};
+
+struct part_bench {
+  const char* day;
+  // 0 is the parse stage of days that have one
+  int part;
+  std::string result;
+  timing_stats stats;
+  // Wall time of every timed iteration, in order
+  std::vector<duration_ms> samples;
+  // Mean per iteration, when requested and available
+  std::optional<counter_values> counters;
+};
+
+// Runs every implemented part of `d` on an in-memory `input`, `warmup` untimed times then `iterations` timed times.
+// Days with a parse stage get it benched on its own, and their parts are benched on a single parsed model.
+// With `counters`, they are read around every timed iteration
+std::vector<part_bench> bench_day(const day& d, std::string_view input, const bench_options& options, perf_counters* counters = nullptr);
+
+// Writes `s` as a quoted JSON string
+void write_json_string(std::ostream& out, std::string_view s);
+
+void print_bench_report(std::ostream& out, std::span<const part_bench> results, const bench_options& options);
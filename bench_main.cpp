@@ -0,0 +1,221 @@
+#include "days.hpp"
+#include "bench.hpp"
+#include "bench_store.hpp"
+#include "cli.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+#include <optional>
+#include <iostream>
+#include <cstring>
+
+// aos_bench: timing of the days, and regression checks against stored results
+struct launch_option {
+  struct help {};
+  struct bench {
+    std::string_view day;
+    bench_options options;
+    bool counters = false;
+    // Defaults to the day's input file
+    std::optional<std::string_view> input;
+    // Appends the results to `store`
+    bool save = false;
+    std::string_view store = default_bench_store;
+  };
+  struct compare {
+    std::vector<std::string_view> days;
+    bench_options options;
+    compare_options thresholds;
+    // Prefix of the commit to compare with, defaults to the latest record of each part
+    std::optional<std::string_view> baseline;
+    bool save = false;
+    std::string_view store = default_bench_store;
+  };
+  std::variant<help, bench, compare> mode;
+};
+
+std::optional<report_format> parse_format(std::string_view s) {
+  if (s == "text") { return report_format::text; }
+  if (s == "json") { return report_format::json; }
+  if (s == "csv") { return report_format::csv; }
+  return std::nullopt;
+}
+
+std::optional<launch_option::bench> parse_bench_args(std::span<const char*> args) {
+  auto sent = launch_option::bench{ args[0] };
+  for (size_t i = 1; i < args.size(); ++i) {
+    std::string_view flag = args[i];
+    if (flag == "--counters") {
+      sent.counters = true;
+      continue;
+    }
+    if (flag == "--save") {
+      sent.save = true;
+      continue;
+    }
+    if (i + 1 == args.size()) {
+      return std::nullopt;
+    }
+    std::string_view value = args[++i];
+    try {
+      if (flag == "--iters") {
+        sent.options.iterations = string_view_to<size_t>(value);
+      } else if (flag == "--warmup") {
+        sent.options.warmup = string_view_to<size_t>(value);
+      } else if (flag == "--input") {
+        sent.input = value;
+      } else if (flag == "--store") {
+        sent.store = value;
+      } else if (flag == "--format") {
+        auto format = parse_format(value);
+        if (!format) {
+          return std::nullopt;
+        }
+        sent.options.format = *format;
+      } else {
+        return std::nullopt;
+      }
+    } catch (const std::runtime_error&) {
+      return std::nullopt;
+    }
+  }
+  if (sent.options.iterations == 0) {
+    return std::nullopt;
+  }
+  return sent;
+}
+
+std::optional<launch_option::compare> parse_compare_args(std::span<const char*> args) {
+  auto sent = launch_option::compare{ parse_day_list(args[0]) };
+  for (size_t i = 1; i < args.size(); ++i) {
+    std::string_view flag = args[i];
+    if (flag == "--save") {
+      sent.save = true;
+      continue;
+    }
+    if (i + 1 == args.size()) {
+      return std::nullopt;
+    }
+    std::string_view value = args[++i];
+    try {
+      if (flag == "--iters") {
+        sent.options.iterations = string_view_to<size_t>(value);
+      } else if (flag == "--warmup") {
+        sent.options.warmup = string_view_to<size_t>(value);
+      } else if (flag == "--baseline") {
+        sent.baseline = value;
+      } else if (flag == "--store") {
+        sent.store = value;
+      } else if (flag == "--alpha") {
+        sent.thresholds.alpha = string_view_to<double>(value);
+      } else if (flag == "--threshold") {
+        sent.thresholds.threshold = string_view_to<double>(value) / 100;
+      } else {
+        return std::nullopt;
+      }
+    } catch (const std::runtime_error&) {
+      return std::nullopt;
+    }
+  }
+  if (sent.options.iterations == 0) {
+    return std::nullopt;
+  }
+  return sent;
+}
+
+launch_option parse_args(int ac, const char** av) {
+  launch_option sent = { .mode = launch_option::help{} };
+  if (ac >= 3 && strcmp(av[1], "bench") == 0) {
+    if (auto bench = parse_bench_args(std::span(av + 2, ac - 2))) {
+      sent.mode = *bench;
+    }
+  }
+  if (ac >= 3 && strcmp(av[1], "compare") == 0) {
+    if (auto compare = parse_compare_args(std::span(av + 2, ac - 2))) {
+      sent.mode = std::move(*compare);
+    }
+  }
+  return sent;
+}
+
+int main(int ac, const char** av) {
+  return match(parse_args(ac, av).mode,
+    [exec = av[0]](launch_option::help) {
+      std::cout << "Usage: " << exec_name(exec) << " bench <day> [--iters N] [--warmup M] [--format text|json|csv] [--counters] [--input <file>] [--save] [--store <file>]\n"
+        << "       " << exec_name(exec) << " compare all|<day>,<day>,... [--iters N] [--warmup M] [--baseline <commit>] [--alpha A] [--threshold PERCENT] [--save] [--store <file>]\n";
+      return 0;
+    },
+    [](const launch_option::bench& bench) {
+      const day* d = find_day(bench.day);
+      if (!d) {
+        std::cerr << "DAY NOT FOUND\n";
+        return 1;
+      }
+      auto input = mapped_file::open(bench.input ? std::string(*bench.input) : input_filename(bench.day));
+      if (!input) {
+        std::cerr << "NO INPUT\n";
+        return 1;
+      }
+      if (!d->part1) {
+        std::cerr << "NOT IMPLEMENTED\n";
+        return 1;
+      }
+      std::optional<perf_counters> counters;
+      if (bench.counters) {
+        // Hardware counters are opened per thread, the loops of the day are kept on the thread counting them
+        set_parallelism(1);
+        std::cerr << "Counters only count the benchmarking thread, its parallel loops run on it alone\n";
+        counters.emplace();
+        if (!counters->available()) {
+          std::cerr << "Counters unavailable: " << counters->error() << '\n';
+        }
+      }
+      auto results = bench_day(*d, input->view(), bench.options, counters ? &*counters : nullptr);
+      print_bench_report(std::cout, results, bench.options);
+      if (bench.save) {
+        auto build = build_info::current();
+        auto records = std::vector<bench_record>{};
+        for (const part_bench& r : results) {
+          records.push_back(make_record(r, bench.options, build));
+        }
+        if (!append_records(std::string(bench.store), records)) {
+          std::cerr << "CANNOT WRITE " << bench.store << '\n';
+          return 1;
+        }
+      }
+      return 0;
+    },
+    [](const launch_option::compare& compare) {
+      const auto records = load_records(std::string(compare.store));
+      const auto build = build_info::current();
+      auto to_save = std::vector<bench_record>{};
+      bool failed = false;
+      for (std::string_view name : compare.days) {
+        const day* d = find_day(name);
+        auto input = mapped_file::open(input_filename(name));
+        if (!d || !input || !d->part1) {
+          std::cout << name << ": " << (!d ? "DAY NOT FOUND" : !input ? "NO INPUT" : "NOT IMPLEMENTED") << '\n';
+          failed = failed || !d;
+          continue;
+        }
+        for (const part_bench& r : bench_day(*d, input->view(), compare.options)) {
+          if (compare.save) {
+            to_save.push_back(make_record(r, compare.options, build));
+          }
+          const bench_record* baseline = find_baseline(records, r.day, r.part, compare.baseline);
+          if (!baseline) {
+            std::cout << r.day << ' ' << (r.part == 0 ? std::string("parse") : "part " + std::to_string(r.part)) << ": NO BASELINE\n";
+            continue;
+          }
+          auto comparison = compare_part(*baseline, r, compare.thresholds);
+          print_comparison(std::cout, comparison);
+          failed = failed || comparison.regressed;
+        }
+      }
+      if (compare.save && !append_records(std::string(compare.store), to_save)) {
+        std::cerr << "CANNOT WRITE " << compare.store << '\n';
+        return 1;
+      }
+      return failed ? 1 : 0;
+    }
+  );
+}
@@ -0,0 +1,470 @@
+#include "bench_store.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <ostream>
+#include <ranges>
+#include <sstream>
+#include "tests.hpp"
+
+// Defined by the build, see CMakeLists.txt
+#ifndef AOS_BUILD_COMMIT
+#define AOS_BUILD_COMMIT "unknown"
+#endif
+#ifndef AOS_BUILD_COMPILER
+#if defined(_MSC_VER)
+#define AOS_BUILD_COMPILER "MSVC " _CRT_STRINGIZE(_MSC_VER)
+#elif defined(__VERSION__)
+#define AOS_BUILD_COMPILER __VERSION__
+#else
+#define AOS_BUILD_COMPILER "unknown"
+#endif
+#endif
+#ifndef AOS_BUILD_FLAGS
+#define AOS_BUILD_FLAGS ""
+#endif
+
+namespace {
+
+  // Reads back the flat objects written by write_record: strings, numbers, null and arrays of those
+  class json_reader {
+  public:
+    explicit json_reader(std::string_view s)
+      : m_s(s)
+    {}
+
+    bool consume(char c) {
+      skip_spaces();
+      if (m_s.empty() || m_s.front() != c) {
+        return false;
+      }
+      m_s.remove_prefix(1);
+      return true;
+    }
+
+    bool at_end() {
+      skip_spaces();
+      return m_s.empty();
+    }
+
+    std::optional<std::string> string() {
+      if (!consume('"')) {
+        return std::nullopt;
+      }
+      std::string sent;
+      while (!m_s.empty() && m_s.front() != '"') {
+        char c = m_s.front();
+        m_s.remove_prefix(1);
+        if (c != '\\') {
+          sent.push_back(c);
+          continue;
+        }
+        if (m_s.empty()) {
+          return std::nullopt;
+        }
+        char escaped = m_s.front();
+        m_s.remove_prefix(1);
+        switch (escaped) {
+        case 'n': sent.push_back('\n'); break;
+        case 'r': sent.push_back('\r'); break;
+        case 't': sent.push_back('\t'); break;
+        case 'u': {
+          // Only control characters are written that way
+          unsigned code = 0;
+          if (m_s.size() < 4 || std::from_chars(m_s.data(), m_s.data() + 4, code, 16).ptr != m_s.data() + 4 || code > 0x7f) {
+            return std::nullopt;
+          }
+          sent.push_back(static_cast<char>(code));
+          m_s.remove_prefix(4);
+          break;
+        }
+        default: sent.push_back(escaped); break;
+        }
+      }
+      if (!consume('"')) {
+        return std::nullopt;
+      }
+      return sent;
+    }
+
+    std::optional<double> number() {
+      skip_spaces();
+      double sent = 0;
+      auto [ptr, ec] = std::from_chars(m_s.data(), m_s.data() + m_s.size(), sent);
+      if (ec != std::errc()) {
+        return std::nullopt;
+      }
+      m_s.remove_prefix(ptr - m_s.data());
+      return sent;
+    }
+
+    std::optional<std::vector<double>> numbers() {
+      if (!consume('[')) {
+        return std::nullopt;
+      }
+      std::vector<double> sent;
+      if (consume(']')) {
+        return sent;
+      }
+      do {
+        auto n = number();
+        if (!n) {
+          return std::nullopt;
+        }
+        sent.push_back(*n);
+      } while (consume(','));
+      if (!consume(']')) {
+        return std::nullopt;
+      }
+      return sent;
+    }
+
+    bool skip_value() {
+      skip_spaces();
+      if (m_s.starts_with('"')) {
+        return string().has_value();
+      }
+      if (m_s.starts_with("null")) {
+        m_s.remove_prefix(4);
+        return true;
+      }
+      if (consume('[')) {
+        if (consume(']')) {
+          return true;
+        }
+        do {
+          if (!skip_value()) {
+            return false;
+          }
+        } while (consume(','));
+        return consume(']');
+      }
+      return number().has_value();
+    }
+
+  private:
+    void skip_spaces() {
+      while (!m_s.empty() && (m_s.front() == ' ' || m_s.front() == '\t' || m_s.front() == '\r' || m_s.front() == '\n')) {
+        m_s.remove_prefix(1);
+      }
+    }
+
+    std::string_view m_s;
+  };
+
+  double median_ratio(duration_ms current, duration_ms baseline) {
+    return baseline.count() > 0 ? current / baseline - 1 : 0;
+  }
+}
+
+build_info build_info::current() {
+  return build_info{
+    .commit = AOS_BUILD_COMMIT,
+    .compiler = AOS_BUILD_COMPILER,
+    .flags = AOS_BUILD_FLAGS,
+  };
+}
+
+bench_record make_record(const part_bench& bench, const bench_options& options, const build_info& build) {
+  return bench_record{
+    .day = bench.day,
+    .part = bench.part,
+    .build = build,
+    .timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count(),
+    .warmup = options.warmup,
+    .result = bench.result,
+    .stats = bench.stats,
+    .samples = bench.samples,
+  };
+}
+
+// Stats are written for people reading the store, they are computed back from the samples when loading
+void write_record(std::ostream& out, const bench_record& record) {
+  out << "{\"day\":";
+  write_json_string(out, record.day);
+  out << ",\"part\":" << record.part << ",\"commit\":";
+  write_json_string(out, record.build.commit);
+  out << ",\"compiler\":";
+  write_json_string(out, record.build.compiler);
+  out << ",\"flags\":";
+  write_json_string(out, record.build.flags);
+  out << ",\"timestamp\":" << record.timestamp
+    << ",\"iterations\":" << record.samples.size()
+    << ",\"warmup\":" << record.warmup
+    << ",\"min_ms\":" << record.stats.min.count()
+    << ",\"median_ms\":" << record.stats.median.count()
+    << ",\"p90_ms\":" << record.stats.p90.count()
+    << ",\"mean_ms\":" << record.stats.mean.count()
+    << ",\"result\":";
+  write_json_string(out, record.result);
+  out << ",\"samples_ms\":[";
+  for (size_t i = 0; i < record.samples.size(); ++i) {
+    out << (i > 0 ? "," : "") << record.samples[i].count();
+  }
+  out << "]}\n";
+}
+
+std::optional<bench_record> parse_record(std::string_view line) {
+  auto in = json_reader(line);
+  if (!in.consume('{')) {
+    return std::nullopt;
+  }
+  bench_record sent;
+  bool has_day = false;
+  bool has_samples = false;
+  do {
+    auto key = in.string();
+    if (!key || !in.consume(':')) {
+      return std::nullopt;
+    }
+    auto read_string = [&in](std::string& out) {
+      auto s = in.string();
+      if (s) {
+        out = std::move(*s);
+      }
+      return s.has_value();
+    };
+    auto read_number = [&in](auto& out) {
+      auto n = in.number();
+      if (n) {
+        out = static_cast<std::remove_reference_t<decltype(out)>>(*n);
+      }
+      return n.has_value();
+    };
+    bool ok;
+    if (*key == "day") {
+      ok = has_day = read_string(sent.day);
+    } else if (*key == "part") {
+      ok = read_number(sent.part);
+    } else if (*key == "commit") {
+      ok = read_string(sent.build.commit);
+    } else if (*key == "compiler") {
+      ok = read_string(sent.build.compiler);
+    } else if (*key == "flags") {
+      ok = read_string(sent.build.flags);
+    } else if (*key == "timestamp") {
+      ok = read_number(sent.timestamp);
+    } else if (*key == "warmup") {
+      ok = read_number(sent.warmup);
+    } else if (*key == "result") {
+      ok = read_string(sent.result);
+    } else if (*key == "samples_ms") {
+      auto samples = in.numbers();
+      ok = has_samples = samples.has_value();
+      if (samples) {
+        std::ranges::transform(*samples, std::back_inserter(sent.samples), [](double ms) { return duration_ms{ ms }; });
+      }
+    } else {
+      ok = in.skip_value();
+    }
+    if (!ok) {
+      return std::nullopt;
+    }
+  } while (in.consume(','));
+  if (!in.consume('}') || !in.at_end() || !has_day || !has_samples) {
+    return std::nullopt;
+  }
+  sent.stats = timing_stats::from_samples(sent.samples);
+  return sent;
+}
+
+bool append_records(const std::string& path, std::span<const bench_record> records) {
+  auto file = std::ofstream(path, std::ios_base::app);
+  for (const bench_record& r : records) {
+    write_record(file, r);
+  }
+  return static_cast<bool>(file.flush());
+}
+
+std::vector<bench_record> load_records(const std::string& path) {
+  std::vector<bench_record> sent;
+  auto file = std::ifstream(path);
+  for (std::string line; std::getline(file, line);) {
+    if (auto record = parse_record(line)) {
+      sent.push_back(std::move(*record));
+    }
+  }
+  return sent;
+}
+
+const bench_record* find_baseline(std::span<const bench_record> records, std::string_view day, int part, std::optional<std::string_view> commit) {
+  auto found = std::ranges::find_if(records | std::views::reverse, [&](const bench_record& r) {
+    return r.day == day && r.part == part && (!commit || r.build.commit.starts_with(*commit));
+  });
+  return found == std::ranges::rend(records) ? nullptr : &*found;
+}
+
+double mann_whitney_slower(std::span<const duration_ms> baseline, std::span<const duration_ms> current) {
+  const double n1 = static_cast<double>(baseline.size());
+  const double n2 = static_cast<double>(current.size());
+  if (baseline.empty() || current.empty()) {
+    return 1;
+  }
+  // Pooled samples, the flag telling those of the current run
+  std::vector<std::pair<duration_ms, bool>> pooled;
+  pooled.reserve(baseline.size() + current.size());
+  for (duration_ms d : baseline) {
+    pooled.emplace_back(d, false);
+  }
+  for (duration_ms d : current) {
+    pooled.emplace_back(d, true);
+  }
+  std::ranges::sort(pooled);
+  double current_ranks = 0;
+  double ties = 0;
+  for (size_t i = 0; i < pooled.size();) {
+    size_t j = i;
+    while (j < pooled.size() && pooled[j].first == pooled[i].first) {
+      ++j;
+    }
+    // Ranks are 1-based, tied samples share the mean of theirs
+    double rank = (static_cast<double>(i + 1) + static_cast<double>(j)) / 2;
+    for (size_t k = i; k < j; ++k) {
+      if (pooled[k].second) {
+        current_ranks += rank;
+      }
+    }
+    double t = static_cast<double>(j - i);
+    ties += t * t * t - t;
+    i = j;
+  }
+  const double n = n1 + n2;
+  const double u = current_ranks - n2 * (n2 + 1) / 2;
+  const double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+  if (variance <= 0) {
+    return 1;
+  }
+  // With continuity correction
+  const double z = (u - n1 * n2 / 2 - 0.5) / std::sqrt(variance);
+  return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+part_comparison compare_part(const bench_record& baseline, const part_bench& current, const compare_options& options) {
+  auto sent = part_comparison{
+    .day = current.day,
+    .part = current.part,
+    .baseline_commit = baseline.build.commit,
+    .baseline_median = baseline.stats.median,
+    .current_median = current.stats.median,
+    .p_value = mann_whitney_slower(baseline.samples, current.samples),
+    .result_changed = current.part != 0 && baseline.result != current.result,
+  };
+  sent.regressed = sent.p_value < options.alpha && median_ratio(sent.current_median, sent.baseline_median) > options.threshold;
+  return sent;
+}
+
+void print_comparison(std::ostream& out, const part_comparison& comparison) {
+  out << comparison.day << ' ';
+  if (comparison.part == 0) {
+    out << "parse";
+  } else {
+    out << "part " << comparison.part;
+  }
+  auto ratio = median_ratio(comparison.current_median, comparison.baseline_median);
+  out << ": median " << comparison.baseline_median.count() << "ms -> " << comparison.current_median.count() << "ms"
+    << " (" << (ratio >= 0 ? "+" : "") << ratio * 100 << "%, p=" << comparison.p_value << ")"
+    << " against " << comparison.baseline_commit;
+  if (comparison.regressed) {
+    out << " REGRESSION";
+  }
+  if (comparison.result_changed) {
+    out << " RESULT CHANGED";
+  }
+  out << '\n';
+}
+
+#ifdef AOS_TESTS
+TEST(bench_store, record) {
+  auto record = bench_record{
+    .day = "d10",
+    .part = 2,
+    .build = { .commit = "abc123", .compiler = "GNU 12.2.0", .flags = "Release -O3 \"quoted\"" },
+    .timestamp = 1700000000,
+    .warmup = 3,
+    .result = "\n##..\n.##.\t",
+    .samples = { duration_ms{ 1.5 }, duration_ms{ 0.25 }, duration_ms{ 2 } },
+  };
+  record.stats = timing_stats::from_samples(record.samples);
+  auto out = std::ostringstream();
+  write_record(out, record);
+  auto line = out.str();
+  ASSERT_EQ(line.back(), '\n');
+  line.pop_back();
+
+  auto parsed = parse_record(line);
+  ASSERT_TRUE(parsed);
+  EXPECT_EQ(parsed->day, record.day);
+  EXPECT_EQ(parsed->part, record.part);
+  EXPECT_EQ(parsed->build.commit, record.build.commit);
+  EXPECT_EQ(parsed->build.compiler, record.build.compiler);
+  EXPECT_EQ(parsed->build.flags, record.build.flags);
+  EXPECT_EQ(parsed->timestamp, record.timestamp);
+  EXPECT_EQ(parsed->warmup, record.warmup);
+  EXPECT_EQ(parsed->result, record.result);
+  EXPECT_EQ(parsed->samples, record.samples);
+  EXPECT_EQ(parsed->stats.median, duration_ms{ 1.5 });
+
+  EXPECT_FALSE(parse_record(""));
+  EXPECT_FALSE(parse_record("{\"day\":\"d01\"}"));
+  EXPECT_FALSE(parse_record(line.substr(0, line.size() - 1)));
+}
+
+TEST(bench_store, find_baseline) {
+  auto records = std::vector<bench_record>{
+    { .day = "d01", .part = 1, .build = { .commit = "aaa" } },
+    { .day = "d01", .part = 1, .build = { .commit = "bbb" } },
+    { .day = "d01", .part = 2, .build = { .commit = "ccc" } },
+  };
+  EXPECT_EQ(find_baseline(records, "d01", 1, std::nullopt), &records[1]);
+  EXPECT_EQ(find_baseline(records, "d01", 1, "a"), &records[0]);
+  EXPECT_EQ(find_baseline(records, "d01", 2, "a"), nullptr);
+  EXPECT_EQ(find_baseline(records, "d02", 1, std::nullopt), nullptr);
+}
+
+TEST(bench_store, mann_whitney) {
+  auto ms = [](std::initializer_list<double> values) {
+    std::vector<duration_ms> sent;
+    for (double v : values) {
+      sent.emplace_back(v);
+    }
+    return sent;
+  };
+  auto fast = ms({ 10, 11, 10.5, 10.2, 10.8, 10.1, 10.9, 10.4, 10.6, 10.3 });
+  auto slow = ms({ 12, 12.5, 11.8, 12.2, 12.9, 12.1, 12.4, 11.9, 12.6, 12.3 });
+  EXPECT_LT(mann_whitney_slower(fast, slow), 0.001);
+  EXPECT_GT(mann_whitney_slower(slow, fast), 0.999);
+  EXPECT_GT(mann_whitney_slower(fast, fast), 0.4);
+  EXPECT_EQ(mann_whitney_slower(ms({ 1, 1 }), ms({ 1, 1 })), 1);
+  EXPECT_EQ(mann_whitney_slower({}, slow), 1);
+}
+
+TEST(bench_store, compare_part) {
+  auto baseline = bench_record{ .day = "d01", .part = 1, .result = "42" };
+  for (int i = 0; i < 20; ++i) {
+    baseline.samples.emplace_back(10 + i * 0.01);
+  }
+  baseline.stats = timing_stats::from_samples(baseline.samples);
+
+  auto current = part_bench{ .day = "d01", .part = 1, .result = "42" };
+  for (int i = 0; i < 20; ++i) {
+    current.samples.emplace_back(10.3 + i * 0.01);
+  }
+  current.stats = timing_stats::from_samples(current.samples);
+  // Significant, but under the threshold
+  auto small = compare_part(baseline, current, compare_options{});
+  EXPECT_LT(small.p_value, 0.01);
+  EXPECT_FALSE(small.regressed);
+  EXPECT_FALSE(small.result_changed);
+
+  for (duration_ms& d : current.samples) {
+    d *= 1.5;
+  }
+  current.stats = timing_stats::from_samples(current.samples);
+  current.result = "43";
+  auto large = compare_part(baseline, current, compare_options{});
+  EXPECT_TRUE(large.regressed);
+  EXPECT_TRUE(large.result_changed);
+}
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "bench.hpp"
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Where `bench --save` appends and `compare` finds its baseline, next to input/
+inline constexpr const char* default_bench_store = "bench_results.jsonl";
+
+// The build a record comes from, as known when it was configured
+struct build_info {
+  std::string commit;
+  std::string compiler;
+  std::string flags;
+
+  static build_info current();
+};
+
+// One part of a day benched by one run, stored as a JSON object per line.
+// Every sample is kept so that later runs can be tested against it
+struct bench_record {
+  std::string day;
+  int part = 0;
+  build_info build;
+  // Seconds since the epoch
+  int64_t timestamp = 0;
+  size_t warmup = 0;
+  std::string result;
+  timing_stats stats;
+  std::vector<duration_ms> samples;
+};
+
+bench_record make_record(const part_bench& bench, const bench_options& options, const build_info& build);
+
+void write_record(std::ostream& out, const bench_record& record);
+// Empty for lines that are not a record
+std::optional<bench_record> parse_record(std::string_view line);
+
+// Appends to the store at `path`, creating it when missing
+bool append_records(const std::string& path, std::span<const bench_record> records);
+// Every record of the store in the order they were appended, skipping malformed lines
+std::vector<bench_record> load_records(const std::string& path);
+
+// Latest record of `day`'s `part`, from a commit starting with `commit` when given
+const bench_record* find_baseline(std::span<const bench_record> records, std::string_view day, int part, std::optional<std::string_view> commit);
+
+// One-sided Mann-Whitney U test with the normal approximation, corrected for ties:
+// the p-value of `current` samples being no slower than the `baseline` ones
+double mann_whitney_slower(std::span<const duration_ms> baseline, std::span<const duration_ms> current);
+
+struct compare_options {
+  // Significance level of the test
+  double alpha = 0.01;
+  // Significant slowdowns of the median below this ratio are still ignored,
+  // as runs on a busy machine drift by a few percent from one another
+  double threshold = 0.10;
+};
+
+struct part_comparison {
+  std::string day;
+  int part;
+  std::string baseline_commit;
+  duration_ms baseline_median{};
+  duration_ms current_median{};
+  double p_value = 1;
+  bool regressed = false;
+  bool result_changed = false;
+};
+
+part_comparison compare_part(const bench_record& baseline, const part_bench& current, const compare_options& options);
+
+void print_comparison(std::ostream& out, const part_comparison& comparison);
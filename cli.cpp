@@ -0,0 +1,30 @@
+#include "cli.hpp"
+#include "days.hpp"
+#include <cstring>
+#include <ranges>
+
+std::vector<std::string_view> parse_day_list(std::string_view arg) {
+  std::vector<std::string_view> sent;
+  if (arg == "all") {
+    for (const day& d : all_days()) {
+      sent.push_back(d.name);
+    }
+  } else {
+    for (auto&& name : arg | std::views::split(',')) {
+      sent.emplace_back(name.begin(), name.end());
+    }
+  }
+  return sent;
+}
+
+std::string input_filename(std::string_view day) {
+  return std::string{ "input/" }.append(day) + ".txt";
+}
+
+const char* exec_name(const char* arg) {
+  size_t offset = std::strlen(arg) - 1;
+  while (offset > 0 && arg[offset - 1] != '/' && arg[offset - 1] != '\\') {
+    --offset;
+  }
+  return &arg[offset];
+}
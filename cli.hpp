@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Command line pieces shared by aos_cli and aos_bench
+
+// `all` or a comma separated list of days
+std::vector<std::string_view> parse_day_list(std::string_view arg);
+
+// Where the input of `day` is read from, relative to the working directory
+std::string input_filename(std::string_view day);
+
+// File name of the executable from argv[0], for usage lines
+const char* exec_name(const char* arg);
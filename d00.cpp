@@ -1,6 +1,6 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "tests.hpp"
 
 // This is a test day, to make sure setup is alright
 
@@ -10,6 +10,8 @@ REGISTER_DAY("d00",
   }
 );
 
+#ifdef AOS_TESTS
 TEST(d00, basic) {
   EXPECT_EQ(0, 0);
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "days.hpp"
-#include <gtest/gtest.h>
+#include "utils.hpp"
+#include "tests.hpp"
+#include <array>
 #include <vector>
 #include <ranges>
 #include <algorithm>
@@ -23,10 +25,10 @@ std::ostream& operator<<(std::ostream& out, const std::vector<elf>& elves) {
   return out;
 }
 
-std::vector<elf> parse_elves(std::istream& input) {
+std::vector<elf> parse_elves(std::string_view input) {
   std::vector<elf> elves;
   bool new_elf = true;
-  for (std::string line; std::getline(input, line); ) {
+  for (std::string_view line : lines(input)) {
     if (new_elf) {
       elves.emplace_back();
       new_elf = false;
@@ -35,30 +37,83 @@ std::vector<elf> parse_elves(std::istream& input) {
       new_elf = true;
     }
     else {
-      elves.back().total_calories += std::stoull(line);
+      elves.back().total_calories += string_view_to<uint64_t>(line);
     }
   }
   return elves;
 }
 
 REGISTER_DAY("d01",
-  [](std::istream& input) {
-    auto elves = parse_elves(input);
+  [](std::string_view input) {
+    return parse_elves(input);
+  },
+  [](const std::vector<elf>& elves) {
     auto res = std::ranges::max_element(elves, {}, &elf::total_calories);
     return std::to_string(res->total_calories);
   },
-  [](std::istream& input) {
-    auto elves = parse_elves(input);
+  [](std::vector<elf> elves) {
     std::ranges::sort(elves, std::greater<>{}, & elf::total_calories);
     auto top_3 = elves | std::views::take(3) | std::views::transform([](const elf& e) { return e.total_calories; });
     return std::to_string(std::reduce(top_3.begin(), top_3.end()));
   }
 );
 
+// About 250 elves per scale, each carrying 1 to 15 items
+REGISTER_GENERATOR("d01", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  for (size_t elf = 0; elf < 250 * scale; ++elf) {
+    if (elf > 0) {
+      out << '\n';
+    }
+    for (auto items = random.between(1, 15); items > 0; --items) {
+      out << random.between(1000, 60000) << '\n';
+    }
+  }
+})
+
+// Calories of the three heaviest elves so far, heaviest first, and of the elf still being counted
+struct elf_totals {
+  std::array<uint64_t, 3> top{};
+  uint64_t current = 0;
+
+  void close_elf() {
+    for (uint64_t& t : top) {
+      if (current > t) {
+        std::swap(current, t);
+      }
+    }
+    current = 0;
+  }
+
+  std::array<uint64_t, 3> final_top() const {
+    auto sent = *this;
+    sent.close_elf();
+    return sent.top;
+  }
+};
+
+REGISTER_LINE_STREAM("d01", elf_totals,
+  [](elf_totals& totals, std::string_view line) {
+    if (line.empty()) {
+      totals.close_elf();
+    } else {
+      totals.current += string_view_to<uint64_t>(line);
+    }
+  },
+  [](const elf_totals& totals) {
+    return std::to_string(totals.final_top()[0]);
+  },
+  [](const elf_totals& totals) {
+    auto top = totals.final_top();
+    return std::to_string(std::reduce(top.begin(), top.end()));
+  }
+)
+
 #include <sstream>
 
+#ifdef AOS_TESTS
 TEST(d01, parsing) {
-  auto input = std::istringstream(
+  auto input = std::string_view(
 R"(1000
 2000
 3000
@@ -84,4 +139,5 @@ R"(1000
     {10000}
   };
   EXPECT_EQ(elves, target);
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
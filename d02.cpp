@@ -1,5 +1,6 @@
 #include "days.hpp"
-#include <gtest/gtest.h>
+#include "utils.hpp"
+#include "tests.hpp"
 
 enum class Shape {
   Rock, Paper, Scissors
@@ -52,20 +53,32 @@ Shape get_my_shape(char c) {
   }
 }
 
+uint64_t round_score(Shape opponent, Shape my) {
+  uint64_t sent = score_of(my);
+  if (opponent == my) {
+    sent += 3;
+  }
+  else if (my == winner_of(opponent)) {
+    sent += 6;
+  }
+  return sent;
+}
+
+Shape shape_for_end(Shape opponent, char end) {
+  switch (end) {
+  case 'X': return loser_of(opponent);
+  case 'Y': return opponent;
+  case 'Z': return winner_of(opponent);
+  default: throw std::runtime_error("Unkonwn end");
+  }
+}
+
 REGISTER_DAY("d02",
   [](std::istream& input) {
     size_t total_score = 0;
     for (std::string line; std::getline(input, line);) {
       if (!line.empty()) {
-        Shape opponent = get_opponent_shape(line[0]);
-        Shape my = get_my_shape(line[2]);
-        total_score += score_of(my);
-        if (opponent == my) {
-          total_score += 3;
-        }
-        else if (my == winner_of(opponent)) {
-          total_score += 6;
-        }
+        total_score += round_score(get_opponent_shape(line[0]), get_my_shape(line[2]));
       }
     }
     return std::to_string(total_score);
@@ -75,22 +88,38 @@ REGISTER_DAY("d02",
     for (std::string line; std::getline(input, line);) {
       if (!line.empty()) {
         Shape opponent = get_opponent_shape(line[0]);
-        Shape my;
-        switch (line[2]) {
-        case 'X': my = loser_of(opponent); break;
-        case 'Y': my = opponent; break;
-        case 'Z': my = winner_of(opponent); break;
-        default: throw std::runtime_error("Unkonwn end");
-        }
-        total_score += score_of(my);
-        if (opponent == my) {
-          total_score += 3;
-        }
-        else if (my == winner_of(opponent)) {
-          total_score += 6;
-        }
+        total_score += round_score(opponent, shape_for_end(opponent, line[2]));
       }
     }
     return std::to_string(total_score);
   }
-);
\ No newline at end of file
+);
+
+REGISTER_GENERATOR("d02", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  for (size_t round = 0; round < 2500 * scale; ++round) {
+    out << random.pick("ABC") << ' ' << random.pick("XYZ") << '\n';
+  }
+})
+
+// Both readings of the strategy guide at once
+struct strategy_scores {
+  uint64_t as_shapes = 0;
+  uint64_t as_ends = 0;
+};
+
+REGISTER_LINE_STREAM("d02", strategy_scores,
+  [](strategy_scores& scores, std::string_view line) {
+    if (!line.empty()) {
+      Shape opponent = get_opponent_shape(line[0]);
+      scores.as_shapes += round_score(opponent, get_my_shape(line[2]));
+      scores.as_ends += round_score(opponent, shape_for_end(opponent, line[2]));
+    }
+  },
+  [](const strategy_scores& scores) {
+    return std::to_string(scores.as_shapes);
+  },
+  [](const strategy_scores& scores) {
+    return std::to_string(scores.as_ends);
+  }
+)
@@ -32,6 +32,13 @@ struct rucksack_ref {
   }
 };
 
+char badge_of(const std::array<std::string, 3>& group) {
+  return *std::ranges::find_if(group[0], [&group](char item) {
+    return ranges::contains(group[1], item)
+    && ranges::contains(group[2], item);
+  });
+}
+
 REGISTER_DAY("d03",
   [](std::istream& input) {
     uint64_t sum = 0;
@@ -47,14 +54,65 @@ REGISTER_DAY("d03",
     for (std::string line; std::getline(input, line);) {
       group[elf_id] = std::move(line);
       if (++elf_id == 3) {
-        char badge = *std::ranges::find_if(group[0], [&group](char item) {
-          return ranges::contains(group[1], item)
-          && ranges::contains(group[2], item);
-        });
-        sum += priority_of(badge);
+        sum += priority_of(badge_of(group));
         elf_id = 0;
       }
     }
     return std::to_string(sum);
   }
-)
\ No newline at end of file
+)
+
+// Every rucksack gets a single item in both compartments and every group of three a single common badge: each elf of a
+// group draws from letters of its own, those of one compartment apart from those of the other
+REGISTER_GENERATOR("d03", [](std::ostream& out, size_t scale, uint64_t seed) {
+  static constexpr std::string_view items = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  auto random = random_t(seed);
+  for (size_t group = 0; group < 100 * scale; ++group) {
+    char badge = random.pick(items);
+    auto others = std::string(items);
+    others.erase(others.find(badge), 1);
+    random.shuffle(std::span(others));
+    for (size_t elf = 0; elf < 3; ++elf) {
+      const auto own = std::string_view(others).substr(17 * elf, 17);
+      const char duplicate = own[0];
+      const auto first = own.substr(1, 8);
+      const auto second = own.substr(9, 8);
+      auto half = static_cast<size_t>(random.between(4, 16));
+      auto rucksack = std::string(2 * half, ' ');
+      for (size_t i = 0; i < half; ++i) {
+        rucksack[i] = random.pick(first);
+        rucksack[half + i] = random.pick(second);
+      }
+      rucksack[0] = duplicate;
+      rucksack[half] = duplicate;
+      rucksack[random.chance(0.5) ? 1 : half + 1] = badge;
+      random.shuffle(std::span(rucksack).first(half));
+      random.shuffle(std::span(rucksack).last(half));
+      out << rucksack << '\n';
+    }
+  }
+})
+
+struct rucksack_sums {
+  uint64_t duplicates = 0;
+  uint64_t badges = 0;
+  size_t elf_id = 0;
+  std::array<std::string, 3> group;
+};
+
+REGISTER_LINE_STREAM("d03", rucksack_sums,
+  [](rucksack_sums& sums, std::string_view line) {
+    sums.duplicates += priority_of(rucksack_ref(line).duplicate_item());
+    sums.group[sums.elf_id] = line;
+    if (++sums.elf_id == 3) {
+      sums.badges += priority_of(badge_of(sums.group));
+      sums.elf_id = 0;
+    }
+  },
+  [](const rucksack_sums& sums) {
+    return std::to_string(sums.duplicates);
+  },
+  [](const rucksack_sums& sums) {
+    return std::to_string(sums.badges);
+  }
+)
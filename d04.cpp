@@ -1,11 +1,8 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
-#include <regex>
+#include "tests.hpp"
 #include <array>
 
-static const auto re = std::regex(R"((\d+)-(\d+),(\d+)-(\d+))");
-
 struct range {
   uint64_t a, b;
 
@@ -19,21 +16,19 @@ struct range {
   }
 };
 
-std::array<range, 2> parse_line(const std::string& line) {
-  std::smatch match;
-  if (!std::regex_match(line, match, re)) {
+std::array<range, 2> parse_line(std::string_view line) {
+  auto m = match_pattern<"{u}-{u},{u}-{u}">(line);
+  if (!m) {
     throw std::runtime_error("Invalid line");
   }
-  return {
-    range{ std::stoull(match[1]), std::stoull(match[2]) },
-    range{ std::stoull(match[3]), std::stoull(match[4]) }
-  };
+  auto [a, b, c, d] = *m;
+  return { range{ a, b }, range{ c, d } };
 }
 
 REGISTER_DAY("d04",
-  [](std::istream& input) {
+  [](std::string_view input) {
     uint64_t matching = 0;
-    for (std::string line; std::getline(input, line);) {
+    for (std::string_view line : lines(input)) {
       auto [l, r] = parse_line(line);
       if (l.contains(r) || r.contains(l)) {
         matching += 1;
@@ -41,9 +36,9 @@ REGISTER_DAY("d04",
     }
     return std::to_string(matching);
   },
-  [](std::istream& input) {
+  [](std::string_view input) {
     uint64_t matching = 0;
-    for (std::string line; std::getline(input, line);) {
+    for (std::string_view line : lines(input)) {
       auto [l, r] = parse_line(line);
       if (l.overlaps(r) || r.overlaps(l)) {
         matching += 1;
@@ -53,8 +48,19 @@ REGISTER_DAY("d04",
   }
 )
 
+REGISTER_GENERATOR("d04", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  for (size_t pair = 0; pair < 1000 * scale; ++pair) {
+    auto a = random.between(1, 99);
+    auto c = random.between(1, 99);
+    out << a << '-' << random.between(a, 99) << ',' << c << '-' << random.between(c, 99) << '\n';
+  }
+})
+
+#ifdef AOS_TESTS
 TEST(d04, overlaps) {
     auto [l, r] = parse_line("20-61,64-77");
     ASSERT_FALSE(l.overlaps(r));
     ASSERT_FALSE(r.overlaps(l));
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -1,7 +1,6 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
-#include <regex>
+#include "tests.hpp"
 #include <vector>
 #include <stack>
 #include <algorithm>
@@ -38,16 +37,16 @@ struct move {
   size_t ammount, from, to;
 };
 
-move parse_move(const std::string& line) {
-  static const auto re = std::regex(R"(move (\d+) from (\d+) to (\d+))");
-  std::smatch matches;
-  if (!std::regex_match(line, matches, re)) {
+move parse_move(std::string_view line) {
+  auto m = match_pattern<"move {u} from {u} to {u}">(line);
+  if (!m) {
     throw std::runtime_error("Invalid instruction");
   }
+  auto [ammount, from, to] = *m;
   return move{
-    .ammount = std::stoull(matches[1]),
-    .from = std::stoull(matches[2]),
-    .to = std::stoull(matches[3]),
+    .ammount = ammount,
+    .from = from,
+    .to = to,
   };
 }
 
@@ -86,6 +85,54 @@ REGISTER_DAY("d05",
   }
 )
 
+// 9 stacks up to 8 * scale crates high and 500 moves per scale, never emptying a stack
+REGISTER_GENERATOR("d05", [](std::ostream& out, size_t scale, uint64_t seed) {
+  static constexpr size_t stack_count = 9;
+  auto random = random_t(seed);
+  auto stacks = std::vector<std::string>(stack_count);
+  size_t height = 0;
+  for (std::string& stack : stacks) {
+    for (auto crates = random.between(2, 8 * scale); crates > 0; --crates) {
+      stack.push_back(random.pick("ABCDEFGHIJKLMNOPQRSTUVWXYZ"));
+    }
+    height = std::max(height, stack.size());
+  }
+  for (size_t row = height; row-- > 0;) {
+    for (size_t i = 0; i < stack_count; ++i) {
+      out << (i > 0 ? " " : "");
+      if (row < stacks[i].size()) {
+        out << '[' << stacks[i][row] << ']';
+      } else {
+        out << "   ";
+      }
+    }
+    out << '\n';
+  }
+  for (size_t i = 0; i < stack_count; ++i) {
+    out << (i > 0 ? " " : "") << ' ' << i + 1 << ' ';
+  }
+  out << "\n\n";
+
+  auto sizes = std::vector<size_t>();
+  for (const std::string& stack : stacks) {
+    sizes.push_back(stack.size());
+  }
+  for (size_t i = 0; i < 500 * scale; ++i) {
+    size_t from, to;
+    do {
+      from = random.below(stack_count);
+    } while (sizes[from] < 2);
+    do {
+      to = random.below(stack_count);
+    } while (to == from);
+    auto ammount = static_cast<size_t>(random.between(1, static_cast<int64_t>(sizes[from]) - 1));
+    sizes[from] -= ammount;
+    sizes[to] += ammount;
+    out << "move " << ammount << " from " << from + 1 << " to " << to + 1 << '\n';
+  }
+})
+
+#ifdef AOS_TESTS
 TEST(d05, parse) {
   auto stream = std::istringstream(
     R"(
@@ -119,4 +166,5 @@ move 1 from 1 to 2
 )");
   stream.get(); // skip \n put there for readability
   ASSERT_EQ(solve(stream, &old_crane), "CMZ");
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
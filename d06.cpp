@@ -1,6 +1,6 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "tests.hpp"
 
 bool is_valid(std::string_view chunk) {
   for (size_t i = 0; i < chunk.size(); ++i) {
@@ -11,11 +11,10 @@ bool is_valid(std::string_view chunk) {
   return true;
 }
 
-size_t find_marker(std::istream& input, size_t marker_size) {
-  std::string line;
-  std::getline(input, line);
+size_t find_marker(std::string_view input, size_t marker_size) {
+  auto line = input.substr(0, input.find('\n'));
   for (size_t i = marker_size; i < line.size(); ++i) {
-    auto sub = std::string_view(line).substr(i - marker_size, marker_size);
+    auto sub = line.substr(i - marker_size, marker_size);
     if (is_valid(sub)) {
       return i;
     }
@@ -24,34 +23,91 @@ size_t find_marker(std::istream& input, size_t marker_size) {
 }
 
 REGISTER_DAY("d06",
-  [](std::istream& input) {
+  [](std::string_view input) {
     return std::to_string(find_marker(input, 4));
   },
-  [](std::istream& input) {
+  [](std::string_view input) {
     return std::to_string(find_marker(input, 14));
   }
 )
 
+// Markers only show up in the last tenth of the stream, before that only 3 distinct characters are used
+REGISTER_GENERATOR("d06", [](std::ostream& out, size_t scale, uint64_t seed) {
+  static constexpr std::string_view letters = "abcdefghijklmnopqrstuvwxyz";
+  auto random = random_t(seed);
+  const size_t size = 4096 * scale;
+  const size_t marker_at = size - size / 10;
+  auto stream = std::string(size, ' ');
+  for (size_t i = 0; i < marker_at; ++i) {
+    stream[i] = random.pick(letters.substr(0, 3));
+  }
+  auto marker = std::string(letters);
+  random.shuffle(std::span(marker));
+  std::ranges::copy(std::string_view(marker).substr(0, 14), stream.begin() + marker_at);
+  for (size_t i = marker_at + 14; i < size; ++i) {
+    stream[i] = random.pick(letters);
+  }
+  out << stream << '\n';
+})
+
+// Last characters of the first line, looked at as soon as they arrive
+struct marker_search {
+  static constexpr size_t marker_sizes[] = { 4, 14 };
+
+  std::string window;
+  size_t read = 0;
+  bool line_ended = false;
+  std::optional<size_t> found[2];
+
+  std::string answer(size_t part) const {
+    if (!found[part]) {
+      throw std::runtime_error("Not found");
+    }
+    return std::to_string(*found[part]);
+  }
+};
+
+REGISTER_STREAM("d06", marker_search,
+  [](marker_search& search, std::string_view bytes) {
+    for (char c : bytes) {
+      if (c == '\n') {
+        search.line_ended = true;
+      }
+      // The rest of the input is not needed
+      if (search.line_ended || (search.found[0] && search.found[1])) {
+        return;
+      }
+      search.window.push_back(c);
+      if (search.window.size() > marker_search::marker_sizes[1]) {
+        search.window.erase(0, 1);
+      }
+      ++search.read;
+      for (size_t part = 0; part < 2; ++part) {
+        const size_t size = marker_search::marker_sizes[part];
+        if (!search.found[part] && search.window.size() >= size && is_valid(std::string_view(search.window).substr(search.window.size() - size))) {
+          search.found[part] = search.read;
+        }
+      }
+    }
+  },
+  [](const marker_search& search) {
+    return search.answer(0);
+  },
+  [](const marker_search& search) {
+    return search.answer(1);
+  }
+)
+
+#ifdef AOS_TESTS
 TEST(d06, valid) {
   EXPECT_TRUE(is_valid("abcd"));
   EXPECT_FALSE(is_valid("abca"));
 }
 
 TEST(d06, part1) {
-  {
-    auto stream = std::istringstream("bvwbjplbgvbhsrlpgdmjqwftvncz");
-    EXPECT_EQ(find_marker(stream, 4), 5);
-  }
-  {
-    auto stream = std::istringstream("nppdvjthqldpwncqszvftbrmjlhg");
-    EXPECT_EQ(find_marker(stream, 4), 6);
-  }
-  {
-    auto stream = std::istringstream("nznrnfrfntjfmvfwmzdfjlvtqnbhcprsg");
-    EXPECT_EQ(find_marker(stream, 4), 10);
-  }
-  {
-    auto stream = std::istringstream("zcfzfwzzqfrljwzlrfnpqdbhtmscgvjw");
-    EXPECT_EQ(find_marker(stream, 4), 11);
-  }
-}
\ No newline at end of file
+  EXPECT_EQ(find_marker("bvwbjplbgvbhsrlpgdmjqwftvncz", 4), 5);
+  EXPECT_EQ(find_marker("nppdvjthqldpwncqszvftbrmjlhg", 4), 6);
+  EXPECT_EQ(find_marker("nznrnfrfntjfmvfwmzdfjlvtqnbhcprsg", 4), 10);
+  EXPECT_EQ(find_marker("zcfzfwzzqfrljwzlrfnpqdbhtmscgvjw", 4), 11);
+}
+#endif
\ No newline at end of file
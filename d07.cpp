@@ -1,21 +1,23 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "tests.hpp"
 #include <vector>
+#include <set>
 #include <stack>
 #include <algorithm>
 
+// The tree is built in the day memory, and torn down with it
 struct file {
-  std::string name;
+  std::pmr::string name;
   size_t size;
 
   auto operator<=>(const file&) const = default;
 };
 
 struct dir {
-  std::string name;
-  std::vector<file> files;
-  std::vector<dir> subdirs;
+  std::pmr::string name{ day_memory() };
+  std::pmr::vector<file> files{ day_memory() };
+  std::pmr::vector<dir> subdirs{ day_memory() };
 
   auto operator<=>(const dir&) const = default;
 };
@@ -53,12 +55,12 @@ dir parse_input(std::istream& input) {
       }
     } else {
       auto space_index = line.find(' ');
-      auto type = line.substr(0, space_index);
-      auto name = line.substr(space_index + 1);
+      auto type = std::string_view(line).substr(0, space_index);
+      auto name = std::pmr::string(std::string_view(line).substr(space_index + 1), day_memory());
       if (type == "dir") {
         cur->subdirs.push_back({ std::move(name) });
       } else {
-        cur->files.push_back({ std::move(name), std::stoull(type) });
+        cur->files.push_back({ std::move(name), string_view_to<size_t>(type) });
       }
     }
   }
@@ -66,9 +68,9 @@ dir parse_input(std::istream& input) {
 }
 
 struct dir_size {
-  const dir* dir;
+  const ::dir* dir;
   size_t size;
-  std::vector<dir_size> subdir;
+  std::pmr::vector<dir_size> subdir{ day_memory() };
 };
 
 dir_size compute_dir_size(const dir& d) {
@@ -103,13 +105,53 @@ size_t dir_size_under_100000(const dir& root) {
   return total;
 }
 
+// Writes `ls` of the current directory then explores its subdirectories, `dirs` being the count of directories in this tree
+void generate_listing(std::ostream& out, random_t& random, size_t dirs) {
+  auto random_name = [&random]() {
+    auto sent = std::string(static_cast<size_t>(random.between(3, 8)), ' ');
+    for (char& c : sent) {
+      c = random.pick("abcdefghijklmnopqrstuvwxyz");
+    }
+    return sent;
+  };
+
+  auto subdirs = std::vector<std::pair<std::string, size_t>>{};
+  if (dirs > 1) {
+    auto count = std::min<size_t>(dirs - 1, random.between(1, 4));
+    auto names = std::set<std::string>{};
+    while (names.size() < count) {
+      names.insert(random_name());
+    }
+    for (const std::string& name : names) {
+      subdirs.emplace_back(name, 1);
+    }
+    for (size_t left = dirs - 1 - count; left > 0; --left) {
+      ++subdirs[random.below(count)].second;
+    }
+  }
+
+  out << "$ ls\n";
+  for (const auto& [name, size] : subdirs) {
+    out << "dir " << name << '\n';
+  }
+  for (auto files = random.between(0, 5); files > 0; --files) {
+    out << random.between(1000, 300000) << ' ' << random_name() << (random.chance(0.5) ? "." + random_name().substr(0, 3) : "") << '\n';
+  }
+  for (const auto& [name, size] : subdirs) {
+    out << "$ cd " << name << '\n';
+    generate_listing(out, random, size);
+    out << "$ cd ..\n";
+  }
+}
+
 REGISTER_DAY("d07",
   [](std::istream& input) {
-    auto d = parse_input(input);
+    return parse_input(input);
+  },
+  [](const dir& d) {
     return std::to_string(dir_size_under_100000(d));
   },
-  [](std::istream& input) {
-    const auto d = parse_input(input);
+  [](const dir& d) {
     const auto sizes = compute_dir_size(d);
     const auto to_free = 30000000 - (70000000 - sizes.size);
     size_t min_size = 70000000;
@@ -122,6 +164,14 @@ REGISTER_DAY("d07",
   }
 )
 
+// About 180 directories per scale
+REGISTER_GENERATOR("d07", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  out << "$ cd /\n";
+  generate_listing(out, random, 180 * scale);
+})
+
+#ifdef AOS_TESTS
 TEST(d07, parse) {
     auto stream = std::istringstream(R"(
 $ cd /
@@ -220,4 +270,5 @@ $ ls
   auto d = parse_input(stream);
 
   EXPECT_EQ(dir_size_under_100000(d), 95437);
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
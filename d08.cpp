@@ -1,27 +1,29 @@
 #include "days.hpp"
 #include "utils.hpp"
 #include <algorithm>
-#include <gtest/gtest.h>
+#include "kernel_bench.hpp"
+#include "tests.hpp"
 #include <vector>
 
-using forest = std::vector<std::string>;
+using forest = grid2d<char>;
 
 forest parse_forest(std::istream& input) {
-  forest sent;
-  for (std::string line; std::getline(input, line);) {
-    sent.push_back(std::move(line));
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(input, line) && !line.empty();) {
+    lines.push_back(std::move(line));
   }
-  return sent;
+  return forest::from_lines(lines, std::identity{});
 }
 
-using visibility = std::vector<std::vector<bool>>;
+// A byte per tree, as rows and columns are marked from different threads
+using visibility = grid2d<uint8_t>;
 using pos = std::pair<size_t, size_t>;
 
 template<std::ranges::input_range Input>
 auto filter_visible(Input&& i, const forest& f) {
   return i
     | std::views::filter([tallest = std::optional<char>{}, &f](const pos& p) mutable {
-        char tree = f[p.second][p.first];
+        char tree = f(p.first, p.second);
         bool visible = !tallest || tallest < tree;
         if (visible) {
           tallest = tree;
@@ -32,19 +34,18 @@ auto filter_visible(Input&& i, const forest& f) {
 }
 
 visibility map_visibility(const forest& f) {
-  size_t height = f.size();
-  size_t width = f[0].size();
-  visibility v;
-  v.resize(height, std::vector<bool>(width, false));
+  size_t height = f.height();
+  size_t width = f.width();
+  auto v = visibility(width, height);
 
-  for (size_t y = 0; y < height; ++y) {
+  parallel_for(height, [&](size_t y) {
     auto left_to_right = std::views::iota(size_t{ 0 }, width)
       | std::views::transform([y](size_t x) {
           return pos{ x, y };
         })
     ;
     for (const auto [vx, vy] : filter_visible(left_to_right, f)) {
-      v[vy][vx] = true;
+      v(vx, vy) = true;
     }
 
     auto right_to_left = std::views::iota(size_t{ 0 }, width)
@@ -54,18 +55,18 @@ visibility map_visibility(const forest& f) {
         })
     ;
     for (const auto [vx, vy] : filter_visible(right_to_left, f)) {
-      v[vy][vx] = true;
+      v(vx, vy) = true;
     }
-  }
+  });
 
-  for (size_t x = 0; x < width; ++x) {
+  parallel_for(width, [&](size_t x) {
     auto top_to_bottom = std::views::iota(size_t{ 0 }, height)
       | std::views::transform([x](size_t y) {
           return pos{ x, y };
         })
     ;
     for (const auto [vx, vy] : filter_visible(top_to_bottom, f)) {
-      v[vy][vx] = true;
+      v(vx, vy) = true;
     }
 
     auto bottom_to_top = std::views::iota(size_t{ 0 }, height)
@@ -75,30 +76,34 @@ visibility map_visibility(const forest& f) {
         })
     ;
     for (const auto [vx, vy] : filter_visible(bottom_to_top, f)) {
-      v[vy][vx] = true;
+      v(vx, vy) = true;
     }
-  }
+  });
   return v;
 }
 
 size_t count_visible(const visibility& v) {
-  return ranges::reduce(v | std::views::transform([](const std::vector<bool>& row) { return std::ranges::count(row, true); }));
+  return std::ranges::count(v.cells(), true);
 }
 
-using scenic_score = std::vector<std::vector<size_t>>;
+using scenic_score = grid2d<size_t>;
 
 scenic_score map_scenic_score(const forest& f) {
-  size_t height = f.size();
-  size_t width = f[0].size();
-  auto res = scenic_score(height, std::vector<size_t>(width, 0));
-  const auto count_all = [](auto&& input) { return std::ranges::count_if(input, [](const auto&) { return true; }); };
+  size_t height = f.height();
+  size_t width = f.width();
+  auto res = scenic_score(width, height);
+  // Trees on the edge score 0, there are only those
+  if (width <= 2 || height <= 2) {
+    return res;
+  }
 
-  for (size_t x = 1; x < width - 1; ++x) {
+  parallel_for(width - 2, [&](size_t column) {
+    const size_t x = column + 1;
     for (size_t y = 1; y < height - 1; ++y) {
-      char reference = f[y][x];
+      char reference = f(x, y);
 
       auto until_ref = [reference, &f](std::ranges::input_range auto&& input) {
-        auto e = std::ranges::find_if(input, [&](const pos& p) { return f[p.second][p.first] >= reference; });
+        auto e = std::ranges::find_if(input, [&](const pos& p) { return f(p.first, p.second) >= reference; });
         if (e != std::ranges::end(input)) {
           ++e;
         }
@@ -109,67 +114,91 @@ scenic_score map_scenic_score(const forest& f) {
       auto left_score = until_ref(std::views::iota(size_t{ 0 }, x) | std::views::reverse | std::views::transform([y](size_t x) { return pos{ x, y }; }));
       auto down_score = until_ref(std::views::iota(y + 1, height) | std::views::transform([x](size_t y) { return pos{ x, y }; }));
       auto right_score = until_ref(std::views::iota(x + 1, width) | std::views::transform([y](size_t x) { return pos{x, y}; }));
-      res[y][x] = static_cast<size_t>(top_score * left_score * down_score * right_score);
+      res(x, y) = static_cast<size_t>(top_score * left_score * down_score * right_score);
     }
-  }
+  });
   return res;
 }
 
 REGISTER_DAY("d08",
   [](std::istream& input) {
-    return std::to_string(count_visible(map_visibility(parse_forest(input))));
+    return parse_forest(input);
   },
-  [](std::istream& input) {
-    auto scores = map_scenic_score(parse_forest(input));
-    size_t m = std::ranges::max(scores | std::views::transform([](const auto & row) { return std::ranges::max(row); }));
-    return std::to_string(m);
+  [](const forest& f) {
+    return std::to_string(count_visible(map_visibility(f)));
+  },
+  [](const forest& f) {
+    auto scores = map_scenic_score(f);
+    return std::to_string(std::ranges::max(scores.cells()));
   }
 )
 
+REGISTER_GENERATOR("d08", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  const size_t side = scaled_side(99, scale, 2);
+  for (size_t y = 0; y < side; ++y) {
+    for (size_t x = 0; x < side; ++x) {
+      out << random.pick("0123456789");
+    }
+    out << '\n';
+  }
+})
+
 #include <iostream>
+#include <sstream>
 
+#ifdef AOS_TESTS
 TEST(d08, visible) {
-  auto f = forest{
-    {"30373"},
-    {"25512"},
-    {"65332"},
-    {"33549"},
-    {"35390"}
-  };
+  auto in = std::istringstream("30373\n25512\n65332\n33549\n35390\n");
+  auto f = parse_forest(in);
   auto vis = map_visibility(f);
 
-  for (const auto& row : vis) {
-    for (bool v : row) {
-      std::cout << (v ? '+' : '.');
+  for (size_t y = 0; y < vis.height(); ++y) {
+    for (size_t x = 0; x < vis.width(); ++x) {
+      std::cout << (vis(x, y) ? '+' : '.');
     }
     std::cout << std::endl;
   }
 
-  EXPECT_TRUE(vis[1][1]);
-  EXPECT_TRUE(vis[1][2]);
-  EXPECT_TRUE(vis[2][1]);
-  EXPECT_TRUE(vis[2][3]);
-  EXPECT_TRUE(vis[3][2]);
+  EXPECT_TRUE(vis(1, 1));
+  EXPECT_TRUE(vis(2, 1));
+  EXPECT_TRUE(vis(1, 2));
+  EXPECT_TRUE(vis(3, 2));
+  EXPECT_TRUE(vis(2, 3));
   EXPECT_EQ(count_visible(vis), 21);
 }
 
 TEST(d08, sccenic_score) {
-  auto f = forest{
-    {"30373"},
-    {"25512"},
-    {"65332"},
-    {"33549"},
-    {"35390"}
-  };
+  auto in = std::istringstream("30373\n25512\n65332\n33549\n35390\n");
+  auto f = parse_forest(in);
   auto score = map_scenic_score(f);
 
-  for (const auto& row : score) {
-    for (auto s : row) {
+  for (size_t y = 0; y < score.height(); ++y) {
+    for (auto s : score.row(y)) {
       std::cout << s << ' ';
     }
     std::cout << std::endl;
   }
 
-  EXPECT_EQ(score[1][2], 4);
-  EXPECT_EQ(score[3][2], 8);
-}
\ No newline at end of file
+  EXPECT_EQ(score(2, 1), 4);
+  EXPECT_EQ(score(2, 3), 8);
+
+  auto narrow = std::istringstream("3\n2\n6\n");
+  EXPECT_EQ(std::ranges::max(map_scenic_score(parse_forest(narrow)).cells()), 0);
+}
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+// Speedup of the parallel columns, the second argument being the thread count
+void d08_scenic_score_threads(benchmark::State& state) {
+  auto input = std::istringstream(generated_input("d08", state.range(0)));
+  const auto f = parse_forest(input);
+  set_parallelism(state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map_scenic_score(f));
+  }
+  set_parallelism(std::max(std::thread::hardware_concurrency(), 1u));
+  state.SetItemsProcessed(state.iterations() * f.width() * f.height());
+}
+BENCHMARK(d08_scenic_score_threads)->ArgsProduct({ { 16 }, { 1, 2, 4, 8 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+#endif
@@ -1,7 +1,6 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
-#include <set>
+#include "tests.hpp"
 
 namespace {
 
@@ -16,13 +15,20 @@ struct pos {
   }
 };
 
-std::set<pos> pull_head(std::istream& input, size_t rope_len = 2) {
+uint64_t pack_key(const pos& p) {
+  return pack_coords(p.x, p.y);
+}
+
+flat_hash_set<pos> pull_head(std::string_view input, size_t rope_len = 2) {
   auto rope = std::vector<pos>(rope_len, pos{ 0, 0 });
-  auto sent = std::set<pos>{ rope.back() };
+  auto sent = flat_hash_set<pos>({ rope.back() }, day_memory());
 
-  for (std::string line; std::getline(input, line) && line.size() >= 3;) {
+  for (std::string_view line : lines(input)) {
+    if (line.size() < 3) {
+      break;
+    }
     char dir = line[0];
-    for (int64_t ammount = std::stoll(line.substr(2)); ammount > 0; --ammount) {
+    for (int64_t ammount = string_view_to<int64_t>(line.substr(2)); ammount > 0; --ammount) {
       auto& head = rope.front();
       switch (dir) {
       case 'R': ++head.x; break;
@@ -48,16 +54,24 @@ std::set<pos> pull_head(std::istream& input, size_t rope_len = 2) {
 }
 
 REGISTER_DAY("d09",
-  [](std::istream& input) {
+  [](std::string_view input) {
     return std::to_string(pull_head(input, 2).size());
   },
-  [](std::istream& input) {
+  [](std::string_view input) {
     return std::to_string(pull_head(input, 10).size());
   }
 )
 
+REGISTER_GENERATOR("d09", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  for (size_t i = 0; i < 2000 * scale; ++i) {
+    out << random.pick("RLUD") << ' ' << random.between(1, 19) << '\n';
+  }
+})
+
+#ifdef AOS_TESTS
 TEST(d09, visit) {
-  auto stream = std::istringstream(R"(
+  auto input = std::string_view(R"(
 R 4
 U 4
 L 3
@@ -66,10 +80,9 @@ R 4
 D 1
 L 5
 R 2
-)");
-  stream.get();
-  auto visited = pull_head(stream);
-  auto target = std::set<pos>{
+)").substr(1);
+  auto visited = pull_head(input);
+  auto target = flat_hash_set<pos>{
     {0, 0}, {1, 0}, {2, 0}, {3, 0},
     {4, -1},
     {1, -2}, {2, -2}, {3, -2}, {4, -2},
@@ -83,85 +96,78 @@ R 2
 
 TEST(d09, angles) {
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 R 1
 U 2
-)");
-    stream.get();
-    auto visited = pull_head(stream);
-    auto target = std::set<pos>{ {0, 0}, {1, -1} };
+)").substr(1);
+    auto visited = pull_head(input);
+    auto target = flat_hash_set<pos>{ {0, 0}, {1, -1} };
     EXPECT_EQ(visited, target);
   }
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 R 1
 D 2
-)");
-    stream.get();
-    auto visited = pull_head(stream);
-    auto target = std::set<pos>{ {0, 0}, {1, 1} };
+)").substr(1);
+    auto visited = pull_head(input);
+    auto target = flat_hash_set<pos>{ {0, 0}, {1, 1} };
     EXPECT_EQ(visited, target);
   }
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 U 1
 L 2
-)");
-    stream.get();
-    auto visited = pull_head(stream);
-    auto target = std::set<pos>{ {0, 0}, {-1, -1} };
+)").substr(1);
+    auto visited = pull_head(input);
+    auto target = flat_hash_set<pos>{ {0, 0}, {-1, -1} };
     EXPECT_EQ(visited, target);
   }
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 U 1
 R 2
-)");
-    stream.get();
-    auto visited = pull_head(stream);
-    auto target = std::set<pos>{ {0, 0}, {1, -1} };
+)").substr(1);
+    auto visited = pull_head(input);
+    auto target = flat_hash_set<pos>{ {0, 0}, {1, -1} };
     EXPECT_EQ(visited, target);
   }
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 L 1
 U 2
-)");
-    stream.get();
-    auto visited = pull_head(stream);
-    auto target = std::set<pos>{ {0, 0}, {-1, -1} };
+)").substr(1);
+    auto visited = pull_head(input);
+    auto target = flat_hash_set<pos>{ {0, 0}, {-1, -1} };
     EXPECT_EQ(visited, target);
   }
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 L 1
 D 2
-)");
-    stream.get();
-    auto visited = pull_head(stream);
-    auto target = std::set<pos>{ {0, 0}, {-1, 1} };
+)").substr(1);
+    auto visited = pull_head(input);
+    auto target = flat_hash_set<pos>{ {0, 0}, {-1, 1} };
     EXPECT_EQ(visited, target);
   }
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 D 1
 R 2
-)");
-    stream.get();
-    auto visited = pull_head(stream);
-    auto target = std::set<pos>{ {0, 0}, {1, 1} };
+)").substr(1);
+    auto visited = pull_head(input);
+    auto target = flat_hash_set<pos>{ {0, 0}, {1, 1} };
     EXPECT_EQ(visited, target);
   }
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 D 1
 L 2
-)");
-    stream.get();
-    auto visited = pull_head(stream);
-    auto target = std::set<pos>{ {0, 0}, {-1, 1} };
+)").substr(1);
+    auto visited = pull_head(input);
+    auto target = flat_hash_set<pos>{ {0, 0}, {-1, 1} };
     EXPECT_EQ(visited, target);
   }
 }
+#endif
 
 }
\ No newline at end of file
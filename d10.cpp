@@ -1,8 +1,9 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "tests.hpp"
 #include <ranges>
 #include <optional>
+#include <sstream>
 
 class signal_generator {
 public:
@@ -13,8 +14,8 @@ public:
   };
   struct sentinel_t {};
 
-  signal_generator(std::istream& input)
-    : input(&input) {
+  signal_generator(std::string_view input)
+    : line(lines(input).begin()) {
     get_next_instruction();
   }
 
@@ -40,10 +41,10 @@ private:
 
   void get_next_instruction() {
     state.x += add;
-    std::string line;
-    if (std::getline(*input, line)) {
-      if (line.starts_with("addx ")) {
-        add = std::stoull(line.substr(5));
+    if (line != std::default_sentinel) {
+      std::string_view instruction = *line++;
+      if (instruction.starts_with("addx ")) {
+        add = string_view_to<int64_t>(instruction.substr(5));
         instruction_length = 2;
       } else {
         add = 0;
@@ -52,7 +53,7 @@ private:
     }
   }
 
-  std::istream* input;
+  lines_view::iterator line;
   value_type state = { 1, 1 };
   int64_t add = 0;
   int64_t instruction_length = -1;
@@ -60,11 +61,11 @@ private:
 
 static_assert(std::input_iterator<signal_generator>);
 
-auto generate_signal(std::istream& input) {
+auto generate_signal(std::string_view input) {
   return std::ranges::subrange(signal_generator(input), signal_generator::sentinel_t{});
 }
 
-auto interpreted_signal(std::istream& input) {
+auto interpreted_signal(std::string_view input) {
   return generate_signal(input) | std::views::drop(2)
     | std::views::filter([](const signal_generator::value_type& p) {
         return p.cycle >= 20 && (p.cycle - 20) % 40 == 0;
@@ -76,10 +77,10 @@ auto interpreted_signal(std::istream& input) {
 }
 
 REGISTER_DAY("d10",
-  [](std::istream& input) {
+  [](std::string_view input) {
     return std::to_string(ranges::reduce(interpreted_signal(input)));
   },
-  [](std::istream& input) {
+  [](std::string_view input) {
     std::ostringstream res;
     for (const auto& [cycle, x] : generate_signal(input) | std::views::take(40 * 6)) {
       if (cycle % 40 == 1) {
@@ -95,13 +96,31 @@ REGISTER_DAY("d10",
   }
 )
 
+// X stays within the 40 columns of the screen
+REGISTER_GENERATOR("d10", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  int64_t x = 1;
+  for (size_t i = 0; i < 140 * scale; ++i) {
+    if (random.chance(0.4)) {
+      out << "noop\n";
+    } else {
+      int64_t value = 0;
+      while (value == 0 || x + value < 0 || x + value > 39) {
+        value = random.between(-20, 20);
+      }
+      x += value;
+      out << "addx " << value << '\n';
+    }
+  }
+})
+
+#ifdef AOS_TESTS
 TEST(d10, basic) {
-  auto input = std::istringstream(R"(
+  auto input = std::string_view(R"(
 noop
 addx 3
 addx -5
-)");
-  input.get();
+)").substr(1);
   auto res = std::vector<int64_t>{};
   for (const auto& s : generate_signal(input)) {
     res.push_back(s.x);
@@ -111,7 +130,7 @@ addx -5
 }
 
 TEST(d10, part1) {
-  auto input = std::istringstream(R"(
+  auto input = std::string_view(R"(
 addx 15
 addx -11
 addx 6
@@ -258,12 +277,12 @@ addx -11
 noop
 noop
 noop
-)");
-  input.get();
+)").substr(1);
   auto res = std::vector<int64_t>{};
   for (int64_t x : interpreted_signal(input)) {
     res.push_back(x);
   }
   auto target = std::vector<int64_t>{ 420, 1140, 1800, 2940, 2880, 3960 };
   EXPECT_EQ(res, target);
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
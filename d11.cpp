@@ -1,8 +1,10 @@
 #include "days.hpp"
 #include "utils.hpp"
 #include <algorithm>
-#include <gtest/gtest.h>
+#include "tests.hpp"
 #include <array>
+#include <utility>
+#include <functional>
 
 #define CHECK_OVERFLOW 1
 
@@ -19,7 +21,7 @@ public:
   worry operator+(const worry& r) const {
 #ifdef CHECK_OVERFLOW
     if ((r.value > 0 && value > worry_limits::max() - r.value)
-    || (r.value < 0 && value < worry_limits::min() - r.value)) {
+    || (std::cmp_less(r.value, 0) && value < worry_limits::min() - r.value)) {
       throw std::overflow_error("overflow during add");
     }
 #endif
@@ -28,7 +30,7 @@ public:
 
   worry operator-(const worry& r) const {
 #ifdef CHECK_OVERFLOW
-    if ((r.value < 0 && value > worry_limits::max() + r.value)
+    if ((std::cmp_less(r.value, 0) && value > worry_limits::max() + r.value)
       || (r.value > 0 && value < worry_limits::min() + r.value)) {
       throw std::overflow_error("overflow during sub");
     }
@@ -38,8 +40,8 @@ public:
 
   worry operator*(const worry& r) const {
 #ifdef CHECK_OVERFLOW
-    if ((value == -1 && r.value == worry_limits::min())
-      || (r.value == -1 && value == worry_limits::min())
+    if ((std::cmp_equal(value, -1) && r.value == worry_limits::min())
+      || (std::cmp_equal(r.value, -1) && value == worry_limits::min())
       || (r.value != 0 && value > worry_limits::max() / r.value)
       || (r.value != 0 && value < worry_limits::min() / r.value)) {
       throw std::overflow_error("overflow during mul");
@@ -101,7 +103,6 @@ struct monkey {
         [](const std::string& line, monkey& out) {
           auto splitted = std::views::split(line.substr(19), ' ');
           auto it = splitted.begin();
-          auto end = splitted.end();
           std::optional<worry> lsrc, rscr;
           char op;
           if (std::string_view lstr((*it).begin(), (*it).end()); lstr != "old") {
@@ -208,15 +209,50 @@ size_t exec_multiple_rounds(std::vector<monkey>& monkeys, size_t count, bool wor
 
 REGISTER_DAY("d11",
   [](std::istream& input) {
-    auto monkeys = parse_all_monkeys(input);
+    return parse_all_monkeys(input);
+  },
+  [](std::vector<monkey> monkeys) {
     return std::to_string(exec_multiple_rounds(monkeys, 20, false));
   },
-  [](std::istream& input) {
-    auto monkeys = parse_all_monkeys(input);
+  [](std::vector<monkey> monkeys) {
     return std::to_string(exec_multiple_rounds(monkeys, 10000, true));
   }
 )
 
+// 8 monkeys per scale. Tests only use primes up to 23, so that their lcm squared does not overflow
+REGISTER_GENERATOR("d11", [](std::ostream& out, size_t scale, uint64_t seed) {
+  static constexpr int primes[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23 };
+  auto random = random_t(seed);
+  const size_t count = 8 * scale;
+  for (size_t i = 0; i < count; ++i) {
+    out << "Monkey " << i << ":\n";
+    out << "  Starting items: ";
+    for (auto items = random.between(1, 8); items > 0; --items) {
+      out << random.between(50, 99) << (items > 1 ? ", " : "\n");
+    }
+    out << "  Operation: new = old ";
+    if (random.chance(0.1)) {
+      out << "* old\n";
+    } else if (random.chance(0.5)) {
+      out << "* " << random.between(2, 19) << '\n';
+    } else {
+      out << "+ " << random.between(1, 8) << '\n';
+    }
+    out << "  Test: divisible by " << random.pick(primes) << '\n';
+    // Throwing to itself would invalidate the items being iterated
+    size_t if_true, if_false;
+    do {
+      if_true = random.below(count);
+    } while (if_true == i);
+    do {
+      if_false = random.below(count);
+    } while (if_false == i || if_false == if_true);
+    out << "    If true: throw to monkey " << if_true << '\n';
+    out << "    If false: throw to monkey " << if_false << "\n\n";
+  }
+})
+
+#ifdef AOS_TESTS
 TEST(d11, parsing) {
   auto stream = std::istringstream(R"(
 Monkey 0:
@@ -295,4 +331,5 @@ Monkey 3:
   ASSERT_EQ(monkeys[1].inspected, 47830);
   ASSERT_EQ(monkeys[2].inspected, 1938);
   ASSERT_EQ(monkeys[3].inspected, 52013);
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -1,6 +1,6 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "tests.hpp"
 
 namespace {
 
@@ -16,27 +16,36 @@ struct pos {
 
 using elevation = char;
 
+// Surrounded by a border of one cell, which paths never enter
 class elevation_map {
 public:
-  elevation_map(std::vector<std::string> elevations)
-    : elevations(std::move(elevations))
+  using index_t = grid2d_layout::index_t;
+
+  explicit elevation_map(std::span<const std::string> lines)
+    : elevations(grid2d<elevation>::from_lines(lines, std::identity{}, elevation{}, 1))
   {}
 
   elevation_map() = default;
 
   const elevation& operator[](const pos& p) const {
-    return elevations[p.y][p.x];
+    return elevations(p.x, p.y);
   }
 
   elevation& operator[](const pos& p){
-    return elevations[p.y][p.x];
+    return elevations(p.x, p.y);
+  }
+
+  elevation operator[](index_t i) const {
+    return elevations[i];
   }
 
-  size_t height() const { return elevations.size(); }
-  size_t width() const { return elevations.empty() ? 0 : elevations[0].size(); }
+  const grid2d_layout& layout() const { return elevations; }
+  index_t index_of(const pos& p) const { return elevations.index_of(p.x, p.y); }
+  size_t height() const { return elevations.height(); }
+  size_t width() const { return elevations.width(); }
 
 private:
-  std::vector<std::string> elevations;
+  grid2d<elevation> elevations;
 };
 
 struct puzzle {
@@ -62,72 +71,82 @@ puzzle parse_input(std::istream& input) {
     }
     lines.push_back(std::move(line));
   }
-  sent.map = elevation_map(std::move(lines));
+  sent.map = elevation_map(lines);
   return sent;
 }
 
-template<std::predicate<const pos&> IsEnd, std::predicate<char /*cur*/, char /*target*/> IsValidMove>
-size_t find_shortest_path(const pos& start, const elevation_map& map, IsEnd&& is_end, IsValidMove&& is_valid_move) {
-  auto visited = std::set<pos>{ start };
-  auto to_visit = std::vector<pos>{ {start} };
-
-  for (size_t iter = 1; !to_visit.empty(); ++iter) {
-    std::vector<pos> new_pos;
+using index_t = elevation_map::index_t;
 
-    for (const pos& cur : to_visit) {
-      char cur_elevation = map[cur];
-      auto test_position = [&](const pos& p) {
-        if (!is_valid_move(cur_elevation, map[p])) {
-          return false;
-        }
-        if (is_end(p)) {
-          return true;
-        }
-        if (visited.insert(p).second) {
-          new_pos.push_back(p);
+template<std::predicate<index_t> IsEnd, std::predicate<char /*cur*/, char /*target*/> IsValidMove>
+size_t find_shortest_path(const pos& start, const elevation_map& map, IsEnd&& is_end, IsValidMove&& is_valid_move) {
+  const auto offsets = map.layout().neighbor_offsets();
+  const bfs_engine::state_t sources[] = { static_cast<bfs_engine::state_t>(map.index_of(start)) };
+  auto found = bfs_engine().search(map.layout().buffer_size(), sources,
+    [&](index_t cur, auto&& emit) {
+      const char cur_elevation = map[cur];
+      for (index_t offset : offsets) {
+        const index_t p = cur + offset;
+        if (map[p] != elevation{} && is_valid_move(cur_elevation, map[p])) {
+          emit(p);
         }
-        return false;
-      };
-
-      if (cur.y > 0 && test_position(pos{ cur.x, cur.y - 1 })) {
-        return iter;
-      }
-      if (cur.y < map.height() - 1 && test_position(pos{ cur.x, cur.y + 1 })) {
-        return iter;
-      }
-      if (cur.x > 0 && test_position(pos{ cur.x - 1, cur.y })) {
-        return iter;
       }
-      if (cur.x < map.width() - 1 && test_position(pos{ cur.x + 1, cur.y })) {
-        return iter;
-      }
-    }
-    to_visit = std::move(new_pos);
+    },
+    [&](index_t p) { return is_end(p); }
+  );
+  if (!found) {
+    throw std::runtime_error("no solution found");
   }
-  throw std::runtime_error("no solution found");
+  return *found;
 }
 
 size_t best_path_size(const puzzle& input) {
   return find_shortest_path(input.start, input.map,
-    [&input](const pos& p) { return p == input.end; },
-    [&input](char cur, char target) { return target <= cur + 1; }
+    [end = input.map.index_of(input.end)](index_t p) { return p == end; },
+    [](char cur, char target) { return target <= cur + 1; }
   );
 }
 
 REGISTER_DAY("d12",
   [](std::istream& input) {
-    return std::to_string(best_path_size(parse_input(input)));
+    return parse_input(input);
   },
-  [](std::istream& input) {
-    auto puzzle = parse_input(input);
+  [](const puzzle& puzzle) {
+    return std::to_string(best_path_size(puzzle));
+  },
+  [](const puzzle& puzzle) {
     size_t found = find_shortest_path(puzzle.end, puzzle.map,
-      [&puzzle](const pos& p) { return puzzle.map[p] == 'a'; },
-      [&puzzle](char cur, char target) { return target >= cur - 1; }
+      [&puzzle](index_t p) { return puzzle.map[p] == 'a'; },
+      [](char cur, char target) { return target >= cur - 1; }
     );
     return std::to_string(found);
   }
 )
 
+// Elevation rises by columns from S to E, keeping S's row smooth so that there always is a path
+REGISTER_GENERATOR("d12", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  const size_t height = scaled_side(41, scale, 2);
+  const size_t width = std::max<size_t>(scaled_side(170, scale, 2), 26);
+  const size_t start_y = height / 2;
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      auto level = static_cast<int>(x * 25 / (width - 1));
+      if (y == start_y && x == 0) {
+        out << 'S';
+      } else if (y == start_y && x == width - 1) {
+        out << 'E';
+      } else {
+        if (y != start_y) {
+          level = std::max(0, level - static_cast<int>(random.below(3)));
+        }
+        out << static_cast<char>('a' + level);
+      }
+    }
+    out << '\n';
+  }
+})
+
+#ifdef AOS_TESTS
 TEST(d12, part1) {
   auto stream = std::istringstream(R"(
 Sabqponm
@@ -139,4 +158,5 @@ abdefghi
   stream.get();
   EXPECT_EQ(best_path_size(parse_input(stream)), 31);
 }
+#endif
 }
\ No newline at end of file
@@ -1,16 +1,19 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "kernel_bench.hpp"
+#include "tests.hpp"
 #include <vector>
 #include <variant>
 #include <charconv>
 #include <algorithm>
+#include <sstream>
 
 using number = int;
-struct value : std::variant<number, std::vector<value>> {
-  using std::variant<number, std::vector<value>>::variant;
+struct value : std::variant<number, std::pmr::vector<value>> {
+  using std::variant<number, std::pmr::vector<value>>::variant;
 };
-using list = std::vector<value>;
+// Parsed lists are allocated in the day memory
+using list = std::pmr::vector<value>;
 
 std::ostream& operator<<(std::ostream& out, const list& l);
 std::ostream& operator<<(std::ostream& out, const value& v);
@@ -57,7 +60,7 @@ std::istream& operator>>(std::istream& in, list& out) {
 
 std::istream& operator>>(std::istream& in, value& out) {
   if (in.peek() == '[') {
-    return in >> out.emplace<list>();
+    return in >> out.emplace<list>(day_memory());
   }
   return in >> out.emplace<number>();
 }
@@ -93,11 +96,27 @@ std::strong_ordering operator<=>(const list& l, const list& r) {
   return std::strong_ordering::greater;
 }
 
+void generate_packet(std::ostream& out, random_t& random, int depth) {
+  out << '[';
+  for (auto items = random.between(0, 5); items > 0; --items) {
+    if (depth < 4 && random.chance(0.3)) {
+      generate_packet(out, random, depth + 1);
+    } else {
+      out << random.between(0, 10);
+    }
+    if (items > 1) {
+      out << ',';
+    }
+  }
+  out << ']';
+}
+
 REGISTER_DAY("d13",
   [](std::istream& input) {
     size_t total = 0;
     for (size_t i = 1; input; ++i) {
-      list l, r;
+      auto l = list(day_memory());
+      auto r = list(day_memory());
       input >> l;
       input.get();
       input >> r;
@@ -113,11 +132,11 @@ REGISTER_DAY("d13",
     return std::to_string(total);
   },
   [](std::istream& input) {
-    std::vector<list> data;
+    auto data = std::pmr::vector<list>(day_memory());
     const auto key1 = list{ {list{2}} };
     const auto key2 = list{ {list{6}} };
     while (input) {
-      list l;
+      auto l = list(day_memory());
       if (input >> l) {
         data.push_back(std::move(l));
       }
@@ -135,6 +154,20 @@ REGISTER_DAY("d13",
   }
 )
 
+REGISTER_GENERATOR("d13", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  for (size_t pair = 0; pair < 150 * scale; ++pair) {
+    if (pair > 0) {
+      out << '\n';
+    }
+    generate_packet(out, random, 0);
+    out << '\n';
+    generate_packet(out, random, 0);
+    out << '\n';
+  }
+})
+
+#ifdef AOS_TESTS
 TEST(d13, parse) {
   {
     auto stream = std::istringstream("[1,1,3,1,1]");
@@ -185,4 +218,28 @@ TEST(d13, ordering) {
     auto r = list{ 7, 7, 7 };
     EXPECT_FALSE(l < r);
   }
-}
\ No newline at end of file
+}
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+void d13_compare(benchmark::State& state) {
+  auto input = std::istringstream(generated_input("d13", state.range(0)));
+  std::vector<list> packets;
+  for (list l; input >> l;) {
+    packets.push_back(l);
+    input.get();
+    if (input.peek() == '\n') {
+      input.get();
+    }
+  }
+  for (auto _ : state) {
+    size_t ordered = 0;
+    for (size_t i = 0; i + 1 < packets.size(); i += 2) {
+      ordered += (packets[i] <=> packets[i + 1]) != std::strong_ordering::greater;
+    }
+    benchmark::DoNotOptimize(ordered);
+  }
+  state.SetItemsProcessed(state.iterations() * packets.size() / 2);
+}
+BENCHMARK(d13_compare)->RangeMultiplier(4)->Range(1, 64);
+#endif
\ No newline at end of file
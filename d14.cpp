@@ -1,6 +1,10 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "kernel_bench.hpp"
+#include "tests.hpp"
+#ifdef AOS_KERNEL_BENCH
+#include <set>
+#endif
 
 namespace {
 
@@ -20,10 +24,21 @@ struct pos {
   }
 };
 
-struct topography {
-  std::set<pos> blocks;
+uint64_t pack_key(const pos& p) {
+  return pack_coords(p.x, p.y);
+}
+
+// `Set` is only other than flat_hash_set in the benchmark against the std::pmr::set it replaced
+template<typename Set>
+struct basic_topography {
+  Set blocks{ day_memory() };
   dist depth = 0;
 
+  // A copy whose blocks live in the current day memory
+  basic_topography copy() const {
+    return basic_topography{ .blocks = Set(blocks, day_memory()), .depth = depth };
+  }
+
   bool drop_sand(bool with_abyss = true) {
     static constexpr auto candidates = { pos{0, 1}, pos{-1, 1}, pos{1, 1} };
     static constexpr auto start = pos{ 500, 0 };
@@ -55,6 +70,8 @@ struct topography {
   }
 };
 
+using topography = basic_topography<flat_hash_set<pos>>;
+
 pos parse_pos(std::string_view s) {
   auto found = s.find(',');
   if (found == std::string_view::npos) {
@@ -66,11 +83,12 @@ pos parse_pos(std::string_view s) {
   };
 }
 
-topography parse_topography(std::istream& input) {
-  topography sent;
-  for (std::string line; std::getline(input, line);) {
+template<typename Set = flat_hash_set<pos>>
+basic_topography<Set> parse_topography(std::string_view input) {
+  basic_topography<Set> sent;
+  for (std::string_view line : lines(input)) {
     std::optional<pos> prev;
-    for (const pos& p : std::string_view(line)
+    for (const pos& p : line
       | std::views::split(std::string_view(" -> "))
       | std::views::transform([](auto&& subrange) {
           return parse_pos(std::string_view(subrange.begin(), subrange.end()));
@@ -91,16 +109,19 @@ topography parse_topography(std::istream& input) {
 }
 
 REGISTER_DAY("d14",
-  [](std::istream& input) {
-    auto t = parse_topography(input);
+  [](std::string_view input) {
+    return parse_topography(input);
+  },
+  [](const topography& model) {
+    auto t = model.copy();
     size_t sand_count = 0;
     while (t.drop_sand()) {
       ++sand_count;
     }
     return std::to_string(sand_count);
   },
-  [](std::istream& input) {
-    auto t = parse_topography(input);
+  [](const topography& model) {
+    auto t = model.copy();
     t.depth += 1;
     size_t sand_count = 0;
     while (t.drop_sand(false)) {
@@ -110,12 +131,38 @@ REGISTER_DAY("d14",
   }
 )
 
+// Cups and ledges below the sand source, in a cave sqrt(scale) times as deep as a real one.
+// A wide cup at the bottom keeps sand from falling into the abyss right away
+REGISTER_GENERATOR("d14", [](std::ostream& out, size_t scale, uint64_t seed) {
+  auto random = random_t(seed);
+  const auto depth = static_cast<dist>(scaled_side(170, scale, 2));
+  auto write_path = [&out](std::initializer_list<pos> points) {
+    const char* separator = "";
+    for (const pos& p : points) {
+      out << separator << p.x << ',' << p.y;
+      separator = " -> ";
+    }
+    out << '\n';
+  };
+  write_path({ { 500 - depth / 3, depth - 10 }, { 500 - depth / 3, depth }, { 500 + depth / 3, depth }, { 500 + depth / 3, depth - 10 } });
+  for (size_t path = 1; path < 150 * scale; ++path) {
+    auto p = pos{ random.between(500 - depth / 2, 500 + depth / 2), random.between(10, depth - 1) };
+    auto width = random.between(3, 15);
+    if (random.chance(0.5)) {
+      auto height = std::min(random.between(2, 8), p.y - 1);
+      write_path({ { p.x, p.y - height }, p, { p.x + width, p.y }, { p.x + width, p.y - height } });
+    } else {
+      write_path({ p, { p.x + width, p.y } });
+    }
+  }
+})
+
+#ifdef AOS_TESTS
 TEST(d14, parse) {
-  auto input = std::istringstream(R"(
+  auto input = std::string_view(R"(
 498,4 -> 498,6 -> 496,6
 503,4 -> 502,4 -> 502,9 -> 494,9
-)");
-  input.get();
+)").substr(1);
   auto topo = parse_topography(input);
   EXPECT_EQ(topo.depth, 9);
   EXPECT_EQ(topo.blocks.size(), 20);
@@ -123,11 +170,10 @@ TEST(d14, parse) {
 
 
 TEST(d14, part2) {
-    auto input = std::istringstream(R"(
+    auto input = std::string_view(R"(
 498,4 -> 498,6 -> 496,6
 503,4 -> 502,4 -> 502,9 -> 494,9
-)");
-    input.get();
+)").substr(1);
     auto topo = parse_topography(input);
 
     size_t i = 0;
@@ -137,5 +183,27 @@ TEST(d14, part2) {
     }
     EXPECT_EQ(i, 93);
 }
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+// Part 2, in the blocks set against the std::pmr::set it replaced
+template<typename Set>
+void d14_fill_cave(benchmark::State& state) {
+  const auto model = parse_topography<Set>(generated_input("d14", state.range(0)));
+  size_t sand_count = 0;
+  for (auto _ : state) {
+    auto t = model.copy();
+    t.depth += 1;
+    sand_count = 0;
+    while (t.drop_sand(false)) {
+      ++sand_count;
+    }
+    benchmark::DoNotOptimize(sand_count);
+  }
+  state.SetItemsProcessed(state.iterations() * sand_count);
+}
+BENCHMARK_TEMPLATE(d14_fill_cave, std::pmr::set<pos>)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(d14_fill_cave, flat_hash_set<pos>)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMillisecond);
+#endif
 
 }
\ No newline at end of file
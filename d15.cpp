@@ -1,7 +1,10 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
-#include <regex>
+#include "kernel_bench.hpp"
+#include "tests.hpp"
+#include <algorithm>
+#include <atomic>
+#include <set>
 
 namespace {
 
@@ -45,20 +48,14 @@ struct finding {
   int64_t length;
 };
 
-finding parse_finding(const std::string& s) {
-  static const auto re = std::regex(R"(Sensor at x=(-?\d+), y=(-?\d+): closest beacon is at x=(-?\d+), y=(-?\d+))");
-  std::smatch match;
-  if (!std::regex_match(s, match, re)) {
+finding parse_finding(std::string_view s) {
+  auto m = match_pattern<"Sensor at x={i}, y={i}: closest beacon is at x={i}, y={i}">(s);
+  if (!m) {
     throw std::runtime_error("invalid format");
   }
-  auto sensor = pos{
-    .x = string_view_to<int64_t>(match[1].str()),
-    .y = string_view_to<int64_t>(match[2].str()),
-  };
-  auto beacon = pos{
-    .x = string_view_to<int64_t>(match[3].str()),
-    .y = string_view_to<int64_t>(match[4].str()),
-  };
+  auto [sx, sy, bx, by] = *m;
+  auto sensor = pos{ .x = sx, .y = sy };
+  auto beacon = pos{ .x = bx, .y = by };
   return finding{
     .sensor = sensor,
     .beacon = beacon,
@@ -66,9 +63,12 @@ finding parse_finding(const std::string& s) {
   };
 }
 
-std::vector<finding> parse_findings(std::istream& input) {
+std::vector<finding> parse_findings(std::string_view input) {
   std::vector<finding> findings;
-  for (std::string line; std::getline(input, line) && !line.empty();) {
+  for (std::string_view line : lines(input)) {
+    if (line.empty()) {
+      break;
+    }
     findings.push_back(parse_finding(line));
   }
   return findings;
@@ -83,36 +83,32 @@ size_t part2(const std::vector<finding>& findings, int64_t range) {
          })
       ;
   };
-  for (const finding& f : findings) {
-    auto length = f.length + 1;
-    // top right
-    for (auto cur = pos{ 0, -length }; cur != pos{ length, 0 }; cur += pos{ 1, 1 }) {
-      auto candidate = f.sensor + cur;
-      if (test(candidate)) {
-        return candidate.tuning_frequency();
-      }
-    }
-    // bottom right
-    for (auto cur = pos{ length, 0 }; cur != pos{ 0, length }; cur += pos{ -1, 1 }) {
-      auto candidate = f.sensor + cur;
-      if (test(candidate)) {
-        return candidate.tuning_frequency();
-      }
-    }
-    // bottom left
-    for (auto cur = pos{ 0, length }; cur != pos{ -length, 0 }; cur += pos{ -1, -1 }) {
-      auto candidate = f.sensor + cur;
-      if (test(candidate)) {
-        return candidate.tuning_frequency();
-      }
-    }
-    // top left
-    for (auto cur = pos{ -length, 0 }; cur != pos{ 0, -length }; cur += pos{ 1, -1 }) {
-      auto candidate = f.sensor + cur;
-      if (test(candidate)) {
-        return candidate.tuning_frequency();
+  // Sensors are walked in parallel, the answer being the first found in their order: a walk stops once a sensor
+  // before it found one
+  auto first_found = std::atomic<size_t>{ findings.size() };
+  auto found = std::vector<size_t>(findings.size());
+  parallel_for(findings.size(), [&](size_t i) {
+    const finding& f = findings[i];
+    const auto length = f.length + 1;
+    // top right, bottom right, bottom left and top left
+    const pos corners[] = { { 0, -length }, { length, 0 }, { 0, length }, { -length, 0 } };
+    static constexpr pos steps[] = { { 1, 1 }, { -1, 1 }, { -1, -1 }, { 1, -1 } };
+    for (size_t side = 0; side < 4; ++side) {
+      auto candidate = f.sensor + corners[side];
+      for (int64_t step = 0; step < length; ++step, candidate += steps[side]) {
+        if (first_found.load(std::memory_order_relaxed) < i) {
+          return;
+        }
+        if (test(candidate)) {
+          found[i] = candidate.tuning_frequency();
+          for (size_t first = first_found.load(); i < first && !first_found.compare_exchange_weak(first, i);) {}
+          return;
+        }
       }
     }
+  }, 1);
+  if (first_found < findings.size()) {
+    return found[first_found];
   }
   throw std::runtime_error{ "not found" };
 }
@@ -143,14 +139,45 @@ size_t part1(const std::vector<finding>& findings, int64_t y) {
 }
 
 REGISTER_DAY("d15",
-  [](std::istream& input) {
-    return std::to_string(part1(parse_findings(input), 2000000));
+  [](std::string_view input) {
+    return parse_findings(input);
+  },
+  [](const std::vector<finding>& findings) {
+    return std::to_string(part1(findings, 2000000));
   },
-  [](std::istream& input) {
-    return std::to_string(part2(parse_findings(input), 4000000));
+  [](const std::vector<finding>& findings) {
+    return std::to_string(part2(findings, 4000000));
   }
 )
 
+// About 30 sensors per scale on a jittered grid over a field sqrt(scale) times as wide as the searched one.
+// Sensors stop short of a hidden point, which is left uncovered for part 2
+REGISTER_GENERATOR("d15", [](std::ostream& out, size_t scale, uint64_t seed) {
+  static constexpr int64_t range = 4000000;
+  auto random = random_t(seed);
+  const auto per_side = static_cast<int64_t>(std::ceil(std::sqrt(30.0 * scale)));
+  const auto side = static_cast<int64_t>(scaled_side(range, scale, 2));
+  const auto origin = -(side - range) / 2;
+  const auto spacing = side / per_side;
+  const auto hidden = pos{ random.between(0, range), random.between(0, range) };
+  for (int64_t gy = 0; gy < per_side; ++gy) {
+    for (int64_t gx = 0; gx < per_side; ++gx) {
+      auto sensor = pos{
+        origin + gx * spacing + spacing / 2 + random.between(-spacing / 4, spacing / 4),
+        origin + gy * spacing + spacing / 2 + random.between(-spacing / 4, spacing / 4)
+      };
+      if (sensor == hidden) {
+        ++sensor.x;
+      }
+      auto radius = std::min(spacing * 3 / 2 + random.between(0, spacing / 4), (hidden - sensor).length() - 1);
+      auto dx = random.between(-radius, radius);
+      auto beacon = sensor + pos{ dx, (radius - std::abs(dx)) * (random.chance(0.5) ? 1 : -1) };
+      out << "Sensor at x=" << sensor.x << ", y=" << sensor.y << ": closest beacon is at x=" << beacon.x << ", y=" << beacon.y << '\n';
+    }
+  }
+})
+
+#ifdef AOS_TESTS
 TEST(d15, parsing) {
   auto f = parse_finding("Sensor at x=2, y=18: closest beacon is at x=-2, y=15");
   EXPECT_EQ(f.sensor.x, 2);
@@ -171,16 +198,15 @@ TEST(d15, equality) {
 
 TEST(d15, part1) {
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 Sensor at x=8, y=7: closest beacon is at x=2, y=10
-)");
-    stream.get();
+)").substr(1);
 
-    auto res = part1(parse_findings(stream), 10);
+    auto res = part1(parse_findings(input), 10);
     ASSERT_EQ(res, 12);
   }
   {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 Sensor at x=2, y=18: closest beacon is at x=-2, y=15
 Sensor at x=9, y=16: closest beacon is at x=10, y=16
 Sensor at x=13, y=2: closest beacon is at x=15, y=3
@@ -195,16 +221,15 @@ Sensor at x=17, y=20: closest beacon is at x=21, y=22
 Sensor at x=16, y=7: closest beacon is at x=15, y=3
 Sensor at x=14, y=3: closest beacon is at x=15, y=3
 Sensor at x=20, y=1: closest beacon is at x=15, y=3
-)");
-    stream.get();
+)").substr(1);
 
-    auto res = part1(parse_findings(stream), 10);
+    auto res = part1(parse_findings(input), 10);
     EXPECT_EQ(res, 26);
   }
 }
 
 TEST(d15, part2) {
-  auto stream = std::istringstream(R"(
+  auto input = std::string_view(R"(
 Sensor at x=2, y=18: closest beacon is at x=-2, y=15
 Sensor at x=9, y=16: closest beacon is at x=10, y=16
 Sensor at x=13, y=2: closest beacon is at x=15, y=3
@@ -219,11 +244,21 @@ Sensor at x=17, y=20: closest beacon is at x=21, y=22
 Sensor at x=16, y=7: closest beacon is at x=15, y=3
 Sensor at x=14, y=3: closest beacon is at x=15, y=3
 Sensor at x=20, y=1: closest beacon is at x=15, y=3
-)");
-  stream.get();
+)").substr(1);
 
-  auto res = part2(parse_findings(stream), 20);
+  auto res = part2(parse_findings(input), 20);
   EXPECT_EQ(res, 56000011);
 }
+#endif
 
+#ifdef AOS_KERNEL_BENCH
+void d15_part1(benchmark::State& state) {
+  const auto input = generated_input("d15", state.range(0));
+  const auto findings = parse_findings(input);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(part1(findings, 2000000));
+  }
+}
+BENCHMARK(d15_part1)->Arg(1)->Arg(2)->Unit(benchmark::kMillisecond);
+#endif
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
-#include <regex>
+#include "tests.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <map>
 
 namespace d16 {
   struct room {
@@ -16,15 +19,18 @@ namespace d16 {
     std::vector<room> sent;
     std::vector<std::vector<std::string>> connections;
     for (std::string line; std::getline(input, line);) {
-      static const auto re = std::regex(R"(Valve (\w+) has flow rate=(\d+); tunnel(?:s?) lead(?:s?) to valve(?:s?) (.*))");
-      static const auto delim = std::string(", ");
-      std::smatch matches;
-      if (!std::regex_match(line, matches, re)) {
+      static const auto delim = std::string_view(", ");
+      auto matches = match_pattern<"Valve {w} has flow rate={u}; tunnels lead to valves {*}">(line);
+      if (!matches) {
+        matches = match_pattern<"Valve {w} has flow rate={u}; tunnel leads to valve {*}">(line);
+      }
+      if (!matches) {
         throw std::runtime_error("bad format");
       }
-      sent.push_back(room{ .name = matches[1].str(), .pressure = std::stoull(matches[2].str()) });
+      auto [name, pressure, tunnels] = *matches;
+      sent.push_back(room{ .name = std::string(name), .pressure = pressure });
       std::vector<std::string>& c = connections.emplace_back();
-      for (auto subrange : matches[3].str() | std::views::split(delim)) {
+      for (auto subrange : tunnels | std::views::split(delim)) {
         c.push_back(std::string{ subrange.begin(), subrange.end() });
       }
     }
@@ -36,27 +42,19 @@ namespace d16 {
     return sent;
   }
 
-  size_t find_shortest_dist(size_t from, size_t to, const std::vector<room>& rooms) {
-    auto cur = std::vector<size_t>{ from };
-    auto visited = std::set<size_t>{ from };
-    auto dist = size_t{ 1 };
-    while (!cur.empty()) {
-      auto new_cur = std::vector<size_t>{};
-      for (size_t r : cur) {
-        const room& room = rooms[r];
-        for (size_t connection : room.connections) {
-          if (connection == to) {
-            return dist;
-          }
-          if (visited.insert(connection).second) {
-            new_cur.push_back(connection);
-          }
+  // Distances from `from` to every room, reusing the buffers of `bfs`
+  std::vector<size_t> find_shortest_dists(size_t from, const std::vector<room>& rooms, bfs_engine& bfs) {
+    auto sent = std::vector<size_t>(rooms.size(), std::numeric_limits<size_t>::max());
+    const size_t sources[] = { from };
+    bfs.flood(rooms.size(), sources,
+      [&rooms](size_t r, auto&& emit) {
+        for (size_t connection : rooms[r].connections) {
+          emit(connection);
         }
-      }
-      cur = std::move(new_cur);
-      ++dist;
-    }
-    throw std::runtime_error{ "not found" };
+      },
+      [&sent](size_t r, size_t dist) { sent[r] = dist; }
+    );
+    return sent;
   }
 
   struct candidate {
@@ -65,6 +63,7 @@ namespace d16 {
   };
 
   std::vector<candidate> find_all_paths(const std::vector<size_t>& path, size_t acc_pressure, size_t time_left, const std::vector<room>& rooms, const std::vector<size_t>& relevant_rooms, const std::map<std::pair<size_t, size_t>, size_t>& shortest_dist) {
+    day_checkpoint([] { return "while enumerating the paths"; });
     std::vector<candidate> sent;
     for (size_t r : relevant_rooms) {
       size_t dist = shortest_dist.at({ path.back(), r}) + 1;
@@ -113,22 +112,43 @@ namespace d16 {
     std::sort(relevant_rooms.begin(), relevant_rooms.end());
 
     std::map<std::pair<size_t, size_t>, size_t> shortest_dist;
-    for (auto from = relevant_rooms.begin(); from != relevant_rooms.end(); ++from) {
-      shortest_dist[{start, *from}] = find_shortest_dist(start, *from, rooms);
-      for (auto to = from + 1; to != relevant_rooms.end(); ++to) {
-        size_t dist = find_shortest_dist(*from, *to, rooms);
-        shortest_dist[{ *from, * to }] = dist;
-        shortest_dist[{ *to, *from }] = dist;
+    // The paths add up distances, an unreachable valve must not get through
+    auto reachable = [](size_t dist) {
+      if (dist == std::numeric_limits<size_t>::max()) {
+        throw std::runtime_error{ "not found" };
+      }
+      return dist;
+    };
+    {
+      AOS_TRACE_SCOPE("shortest distances");
+      auto bfs = bfs_engine();
+      auto from_start = find_shortest_dists(start, rooms, bfs);
+      for (size_t from : relevant_rooms) {
+        shortest_dist[{ start, from }] = reachable(from_start[from]);
+        auto dists = find_shortest_dists(from, rooms, bfs);
+        for (size_t to : relevant_rooms) {
+          if (to != from) {
+            shortest_dist[{ from, to }] = reachable(dists[to]);
+          }
+        }
       }
     }
 
-    auto all_candidates = find_all_paths({ start }, 0, time, rooms, relevant_rooms, shortest_dist);
-    
+    auto all_candidates = [&]() {
+      AOS_TRACE_SCOPE("find_all_paths");
+      return find_all_paths({ start }, 0, time, rooms, relevant_rooms, shortest_dist);
+    }();
+
     if (!with_elephant) {
       return std::ranges::max(all_candidates | std::views::transform(&candidate::pressure));
     }
+    AOS_TRACE_SCOPE("pair loop");
     size_t max_pressure = 0;
     for (auto it = all_candidates.begin(); it != all_candidates.end(); ++it) {
+      day_checkpoint([&] {
+        return std::to_string(it - all_candidates.begin()) + " of " + std::to_string(all_candidates.size())
+          + " paths paired, best so far " + std::to_string(max_pressure);
+      });
       for (auto next = it + 1; next != all_candidates.end(); ++next) {
         if (are_exclusives(it->path, next->path)) {
           max_pressure = std::max(max_pressure, it->pressure + next->pressure);
@@ -140,13 +160,67 @@ namespace d16 {
 
   REGISTER_DAY("d16",
     [](std::istream& in) {
-      return std::to_string(maximize_pressure(parse_rooms(in), 30, false));
+      return parse_rooms(in);
     },
-    [](std::istream& in) {
-      return std::to_string(maximize_pressure(parse_rooms(in), 26, true));
+    [](const std::vector<room>& rooms) {
+      return std::to_string(maximize_pressure(rooms, 30, false));
+    },
+    [](const std::vector<room>& rooms) {
+      return std::to_string(maximize_pressure(rooms, 26, true));
     }
   )
 
+  // 60 valves per scale, connected by corridors with a few shortcuts. Only 15 of them have a flow,
+  // as the search is exponential in that count
+  REGISTER_GENERATOR("d16", [](std::ostream& out, size_t scale, uint64_t seed) {
+    auto random = random_t(seed);
+    const size_t count = 60 * scale;
+    auto name_of = [](size_t i) {
+      auto sent = std::string();
+      do {
+        sent.push_back(static_cast<char>('A' + i % 26));
+        i /= 26;
+      } while (sent.size() < 2 || i > 0);
+      return sent;
+    };
+
+    auto tunnels = std::vector<std::vector<size_t>>(count);
+    auto connect = [&tunnels](size_t a, size_t b) {
+      if (a != b && !ranges::contains(tunnels[a], b)) {
+        tunnels[a].push_back(b);
+        tunnels[b].push_back(a);
+      }
+    };
+    for (size_t i = 1; i < count; ++i) {
+      connect(i, i - 1 - random.below(std::min<size_t>(i, 3)));
+    }
+    for (size_t i = 0; i < count / 20; ++i) {
+      connect(random.below(count), random.below(count));
+    }
+    auto flows = std::vector<int64_t>(count, 0);
+    for (size_t valves = std::min<size_t>(15, count - 1); valves > 0;) {
+      // Valve 0 is AA, where we start
+      size_t v = 1 + random.below(count - 1);
+      if (flows[v] == 0) {
+        flows[v] = random.between(2, 25);
+        --valves;
+      }
+    }
+
+    auto order = std::vector<size_t>(count);
+    std::iota(order.begin(), order.end(), 0);
+    random.shuffle(std::span(order));
+    for (size_t i : order) {
+      out << "Valve " << name_of(i) << " has flow rate=" << flows[i] << ';'
+        << (tunnels[i].size() == 1 ? " tunnel leads to valve " : " tunnels lead to valves ");
+      for (size_t t = 0; t < tunnels[i].size(); ++t) {
+        out << (t > 0 ? ", " : "") << name_of(tunnels[i][t]);
+      }
+      out << '\n';
+    }
+  })
+
+#ifdef AOS_TESTS
   TEST(d16, part1) {
     auto stream = std::istringstream(R"(
 Valve AA has flow rate=0; tunnels lead to valves DD, II, BB
@@ -184,4 +258,17 @@ Valve JJ has flow rate=21; tunnel leads to valve II
     auto pressure = maximize_pressure(rooms, 26, true);
     EXPECT_EQ(pressure, 1707);
   }
+
+  TEST(d16, unreachable) {
+    auto stream = std::istringstream(R"(
+Valve AA has flow rate=0; tunnel leads to valve BB
+Valve BB has flow rate=13; tunnel leads to valve AA
+Valve CC has flow rate=2; tunnel leads to valve DD
+Valve DD has flow rate=0; tunnel leads to valve CC
+)");
+    stream.get();
+    auto rooms = parse_rooms(stream);
+    EXPECT_THROW(maximize_pressure(rooms, 30, false), std::runtime_error);
+  }
+#endif
 }
\ No newline at end of file
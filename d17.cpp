@@ -1,6 +1,7 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "kernel_bench.hpp"
+#include "tests.hpp"
 #include <array>
 
 namespace d17 {
@@ -62,68 +63,64 @@ namespace d17 {
     }
 
     struct rock_cycle_t {
+      // Up to the end of the first cycle included
       std::vector<size_t> first_cycles_height;
-      size_t cycle_start;
-      size_t cycle_duration;
-      size_t cycle_height;
+      cycle_t cycle;
 
       size_t height_of_iter(size_t iter) const {
-        if (iter < cycle_start) {
-          return first_cycles_height[iter];
-        }
-        iter -= cycle_start;
-        return cycle_height * (iter / cycle_duration)
-          + first_cycles_height[cycle_start + iter % cycle_duration];
+        return cycle.extrapolate(iter, [this](size_t i) { return first_cycles_height[i]; });
       }
     };
 
+    // The state after a rock is the next pattern, the next move, and the top of the grid down to the line below the
+    // first where every column was covered. The tops are kept one after the other, and compared on equal fingerprints
     static rock_cycle_t find_cycles(std::string input) {
+      AOS_TRACE_SCOPE("find_cycles");
       struct state_t {
         size_t next_pattern;
         size_t next_move;
-        grid_t last_grid;
-
-        auto operator<=>(const state_t&) const = default;
+        size_t top_begin;
+        size_t top_end;
       };
 
       auto t = tetris(std::move(input));
-
-      auto visited = std::map<state_t, size_t>{
-        {state_t{
-          .next_pattern = t.m_next_pattern,
-          .next_move = t.m_next_move,
-          .last_grid = grid_t{}
-        }, 0}
-      };
-      auto heights = std::vector<size_t>{ {0} };
+      auto detector = cycle_detector();
+      auto states = std::vector<state_t>();
+      auto tops = grid_t();
+      auto heights = std::vector<size_t>();
 
       while (true) {
-        t.drop_rock();
-        auto max_drop = t.m_grid.end() - 1;
-        line_t mask = 0;
-        while (max_drop != t.m_grid.begin() && mask != 0b11111110) {
-          mask |= *max_drop;
-          --max_drop;
+        auto max_drop = t.m_grid.begin();
+        if (!t.m_grid.empty()) {
+          max_drop = t.m_grid.end() - 1;
+          line_t mask = 0;
+          while (max_drop != t.m_grid.begin() && mask != 0b11111110) {
+            mask |= *max_drop;
+            --max_drop;
+          }
         }
-        auto state = state_t{
-          .next_pattern = t.m_next_pattern,
-          .next_move = t.m_next_move,
-          .last_grid = grid_t(max_drop, t.m_grid.end())
-        };
-        auto [it, inserted] = visited.insert(std::make_pair(std::move(state), heights.size()));
-        if (!inserted) {
-          size_t cycle_start = it->second;
-          size_t cycle_duration = heights.size() - cycle_start;
-          size_t cycle_height = t.grid_height() - heights[cycle_start];
-          // we found the cycle
+        const auto top = std::span<const line_t>(max_drop, t.m_grid.end());
+        const auto fingerprint = fingerprint_t().add(t.m_next_pattern).add(t.m_next_move).add(top).value();
+        auto cycle = detector.add(fingerprint, [&](size_t earlier) {
+          const state_t& e = states[earlier];
+          return e.next_pattern == t.m_next_pattern && e.next_move == t.m_next_move
+            && std::ranges::equal(std::span(tops).subspan(e.top_begin, e.top_end - e.top_begin), top);
+        });
+        heights.push_back(t.grid_height());
+        if (cycle) {
           return rock_cycle_t{
             .first_cycles_height = std::move(heights),
-            .cycle_start = cycle_start,
-            .cycle_duration = cycle_duration,
-            .cycle_height = cycle_height
+            .cycle = *cycle
           };
         }
-        heights.push_back(t.grid_height());
+        states.push_back(state_t{
+          .next_pattern = t.m_next_pattern,
+          .next_move = t.m_next_move,
+          .top_begin = tops.size(),
+          .top_end = tops.size() + top.size()
+        });
+        tops.insert(tops.end(), top.begin(), top.end());
+        t.drop_rock();
       }
     }
 
@@ -157,7 +154,7 @@ namespace d17 {
       }
       for (size_t py = 0; py < p.size(); ++py) {
         line_t line = p[py];
-        if ((line & (1 << (x + 1)) - 1) != 0) {
+        if ((line & ((1 << (x + 1)) - 1)) != 0) {
           return true;
         }
         if (y + py < m_grid.size()) {
@@ -208,6 +205,15 @@ namespace d17 {
     }
   )
 
+  REGISTER_GENERATOR("d17", [](std::ostream& out, size_t scale, uint64_t seed) {
+    auto random = random_t(seed);
+    for (size_t i = 0; i < 10091 * scale; ++i) {
+      out << random.pick("<>");
+    }
+    out << '\n';
+  })
+
+#ifdef AOS_TESTS
   TEST(d17, tetris) {
     auto t = tetris(">>><<><>><<<>><>>><<<>>><<<><<<>><>><<>>");
 
@@ -237,7 +243,7 @@ namespace d17 {
     std::string input = ">>><<><>><<<>><>>><<<>>><<<><<<>><>><<>>";
     auto cycles = tetris::find_cycles(input);
     auto t = tetris(input);
-    for (size_t i = 0; i <= cycles.cycle_start + 2 * cycles.cycle_duration; ++i) {
+    for (size_t i = 0; i <= cycles.cycle.start + 2 * cycles.cycle.period; ++i) {
       ASSERT_EQ(cycles.height_of_iter(i), t.grid_height()) << " i == " << i;
       t.drop_rock();
     }
@@ -249,7 +255,7 @@ namespace d17 {
     std::getline(f, input);
     auto cycles = tetris::find_cycles(input);
     auto t = tetris(input);
-    for (size_t i = 0; i <= cycles.cycle_start + 2 * cycles.cycle_duration; ++i) {
+    for (size_t i = 0; i <= cycles.cycle.start + 2 * cycles.cycle.period; ++i) {
       ASSERT_EQ(cycles.height_of_iter(i), t.grid_height()) << " i == " << i;
       t.drop_rock();
     }
@@ -264,4 +270,18 @@ namespace d17 {
     auto size = find_height_after(">>><<><>><<<>><>>><<<>>><<<><<<>><>><<>>", 1000000000000);
     ASSERT_EQ(size, 1514285714288);
   }
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+  void d17_drop_rock(benchmark::State& state) {
+    auto jets = generated_input("d17", state.range(0));
+    jets.pop_back();
+    auto t = tetris(std::move(jets));
+    for (auto _ : state) {
+      t.drop_rock();
+    }
+    state.SetItemsProcessed(state.iterations());
+  }
+  BENCHMARK(d17_drop_rock)->Arg(1)->Arg(16);
+#endif
 }
\ No newline at end of file
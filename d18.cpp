@@ -1,6 +1,12 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "kernel_bench.hpp"
+#include "tests.hpp"
+#include <limits>
+#ifdef AOS_KERNEL_BENCH
+#include <map>
+#include <set>
+#endif
 
 namespace d18 {
   struct pos_t {
@@ -13,20 +19,18 @@ namespace d18 {
     }
   };
 
+  uint64_t pack_key(const pos_t& p) {
+    return pack_coords(p.x, p.y, p.z);
+  }
+
   pos_t parse_pos(std::string_view s) {
-    static const auto delim = std::string{ "," };
-    union {
-      pos_t sent;
-      int arr[3];
-    };
-    int i = 0;
-    for (auto&& subrange : s | std::views::split(delim)) {
-      arr[i++] = string_view_to<int>(std::string_view{ subrange.begin(), subrange.end() });
-    }
-    return sent;
+    auto [x, y, z] = scan_integers<int, 3>(s);
+    return { x, y, z };
   }
 
-  size_t count_free_side(std::istream& input, bool ignore_pockets) {
+  // `Set` and `Map` are only other than the flat hash ones in the benchmark against the std::pmr ones they replaced
+  template<typename Set = flat_hash_set<pos_t>, typename Map = flat_hash_map<pos_t, size_t>>
+  size_t count_free_side(std::string_view input, bool ignore_pockets) {
     static constexpr pos_t sides[] = {
       { 1, 0, 0 },
       { -1, 0, 0 },
@@ -35,10 +39,10 @@ namespace d18 {
       { 0, 0, 1 },
       { 0, 0, -1 },
     };
-    std::set<pos_t> cubes;
-    std::map<pos_t, size_t> free_space;
+    auto cubes = Set(day_memory());
+    auto free_space = Map(day_memory());
 
-    for (std::string line; std::getline(input, line);) {
+    for (std::string_view line : lines(input)) {
       pos_t cube = parse_pos(line);
       free_space.erase(cube);
       for (const pos_t& side : sides) {
@@ -51,55 +55,91 @@ namespace d18 {
       }
       cubes.insert(cube);
     }
-    if (ignore_pockets) {
+    if (ignore_pockets || cubes.empty()) {
       return ranges::reduce(free_space | std::views::values);
     }
-    pos_t min = { -1, -1, -1 };
-    pos_t max = { 25, 25, 25 };
+    // The exterior is flooded from a corner of the box around the droplet, one cell larger on every side
+    pos_t min = *cubes.begin();
+    pos_t max = min;
+    for (const pos_t& c : cubes) {
+      min = { std::min(min.x, c.x), std::min(min.y, c.y), std::min(min.z, c.z) };
+      max = { std::max(max.x, c.x), std::max(max.y, c.y), std::max(max.z, c.z) };
+    }
+    min = min + pos_t{ -1, -1, -1 };
+    max = max + pos_t{ 1, 1, 1 };
+    const auto size = max + pos_t{ 1 - min.x, 1 - min.y, 1 - min.z };
+    auto index_of = [&](const pos_t& p) {
+      return static_cast<size_t>(((p.z - min.z) * size.y + p.y - min.y) * size.x + p.x - min.x);
+    };
+    auto pos_of = [&](size_t i) {
+      const auto c = static_cast<int>(i);
+      return pos_t{ c % size.x + min.x, c / size.x % size.y + min.y, c / size.x / size.y + min.z };
+    };
+
+    // Per cell of the box, the count of cube sides it touches, or none for the cubes themselves
+    static constexpr size_t solid = std::numeric_limits<size_t>::max();
+    auto sides_touched = std::pmr::vector<size_t>(static_cast<size_t>(size.x) * size.y * size.z, 0, day_memory());
+    for (const pos_t& c : cubes) {
+      sides_touched[index_of(c)] = solid;
+    }
+    for (const auto& [p, count] : free_space) {
+      sides_touched[index_of(p)] = count;
+    }
+
     size_t free = 0;
-    auto seen = std::set<pos_t>{ min };
-    auto to_see = std::vector<pos_t>{ min };
-    while (!to_see.empty()) {
-      auto new_to_see = std::vector<pos_t>{};
-      for (const pos_t& cur : to_see) {
-        for (pos_t s : sides | std::views::transform([&cur](const pos_t& s) { return cur + s; })) {
-          if (s.x >= min.x && s.y >= min.y && s.z >= min.z
-            && s.x <= max.x && s.y <= max.y && s.z <= max.z
-            && !cubes.contains(s) && seen.insert(s).second) {
-            auto found = free_space.find(s);
-            if (found != free_space.end()) {
-              free += found->second;
-            }
-            new_to_see.push_back(s);
+    const size_t sources[] = { index_of(min) };
+    bfs_engine().flood(sides_touched.size(), sources,
+      [&](size_t cur, auto&& emit) {
+        const pos_t p = pos_of(cur);
+        for (const pos_t& side : sides) {
+          const pos_t s = p + side;
+          if (s.x >= min.x && s.y >= min.y && s.z >= min.z && s.x <= max.x && s.y <= max.y && s.z <= max.z
+            && sides_touched[index_of(s)] != solid) {
+            emit(index_of(s));
           }
         }
-      }
-      to_see = std::move(new_to_see);
-    }
+      },
+      [&](size_t cur, size_t) { free += sides_touched[cur]; }
+    );
     return free;
   }
 
   REGISTER_DAY("d18",
-    [](std::istream& in) {
+    [](std::string_view in) {
       return std::to_string(count_free_side(in, true));
     },
-    [](std::istream& in) {
+    [](std::string_view in) {
       return std::to_string(count_free_side(in, false));
     }
   )
 
+  // A third of the cells of a box holding scale times the cells of a real droplet
+  REGISTER_GENERATOR("d18", [](std::ostream& out, size_t scale, uint64_t seed) {
+    auto random = random_t(seed);
+    const auto side = static_cast<int>(scaled_side(20, scale, 3));
+    for (int x = 1; x <= side; ++x) {
+      for (int y = 1; y <= side; ++y) {
+        for (int z = 1; z <= side; ++z) {
+          if (random.chance(0.35)) {
+            out << x << ',' << y << ',' << z << '\n';
+          }
+        }
+      }
+    }
+  })
+
+#ifdef AOS_TESTS
   TEST(d18, basic) {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 1,1,1
 2,1,1
-)");
-    stream.get();
-    auto res = count_free_side(stream, true);
+)").substr(1);
+    auto res = count_free_side(input, true);
     ASSERT_EQ(res, 10);
   }
 
   TEST(d18, part1) {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 2,2,2
 1,2,2
 3,2,2
@@ -113,14 +153,13 @@ namespace d18 {
 3,2,5
 2,1,5
 2,3,5
-)");
-    stream.get();
-    auto res = count_free_side(stream, true);
+)").substr(1);
+    auto res = count_free_side(input, true);
     ASSERT_EQ(res, 64);
   }
 
   TEST(d18, part2) {
-    auto stream = std::istringstream(R"(
+    auto input = std::string_view(R"(
 2,2,2
 1,2,2
 3,2,2
@@ -134,9 +173,27 @@ namespace d18 {
 3,2,5
 2,1,5
 2,3,5
-)");
-    stream.get();
-    auto res = count_free_side(stream, false);
+)").substr(1);
+    auto res = count_free_side(input, false);
     ASSERT_EQ(res, 58);
+    ASSERT_EQ(count_free_side("", false), 0);
+  }
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+  template<typename Set, typename Map>
+  void d18_exterior_sides(benchmark::State& state) {
+    const auto input = generated_input("d18", state.range(0));
+    size_t cubes = 0;
+    for (std::string_view line : lines(input)) {
+      cubes += !line.empty();
+    }
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(count_free_side<Set, Map>(input, false));
+    }
+    state.SetItemsProcessed(state.iterations() * cubes);
   }
+  BENCHMARK_TEMPLATE(d18_exterior_sides, std::pmr::set<pos_t>, std::pmr::map<pos_t, size_t>)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMillisecond);
+  BENCHMARK_TEMPLATE(d18_exterior_sides, flat_hash_set<pos_t>, flat_hash_map<pos_t, size_t>)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMillisecond);
+#endif
 }
\ No newline at end of file
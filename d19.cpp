@@ -1,8 +1,11 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
-#include <regex>
+#include "kernel_bench.hpp"
+#include "tests.hpp"
 #include <array>
+#include <cassert>
+#include <functional>
+#include <sstream>
 
 namespace d19 {
 
@@ -50,22 +53,28 @@ namespace d19 {
       line = line.substr(column + 1);
     }
     for (auto&& subrange : line | std::views::split(std::string_view{ "." })) {
-      static const auto re = std::regex(R"( Each (\w+) robot costs (\d+) (\w+)( and (\d+) (\w+))?)");
-
       auto blueprint_str = std::string_view(subrange.begin(), subrange.end());
-      std::match_results<std::string_view::const_iterator> matches;
-      if (std::regex_match(blueprint_str.begin(), blueprint_str.end(), matches, re)) {
-        minerals_t robot = parse_minerals(matches[1].str());
-        sent[robot][parse_minerals(matches[3].str())] = string_view_to<quantity_t>(matches[2].str());
-        if (matches[4].length() > 0) {
-          sent[robot][parse_minerals(matches[6].str())] = string_view_to<quantity_t>(matches[5].str());
-        }
+      if (auto m = match_pattern<" Each {w} robot costs {u} {w} and {u} {w}">(blueprint_str)) {
+        auto [robot, count1, mineral1, count2, mineral2] = *m;
+        sent[parse_minerals(robot)][parse_minerals(mineral1)] = count1;
+        sent[parse_minerals(robot)][parse_minerals(mineral2)] = count2;
+      } else if (auto m = match_pattern<" Each {w} robot costs {u} {w}">(blueprint_str)) {
+        auto [robot, count, mineral] = *m;
+        sent[parse_minerals(robot)][parse_minerals(mineral)] = count;
       }
     }
 
     return sent;
   }
 
+  std::vector<blueprints_t> parse_blueprints(std::istream& input) {
+    std::vector<blueprints_t> sent;
+    for (std::string line; std::getline(input, line);) {
+      sent.push_back(parse_blueprint(line));
+    }
+    return sent;
+  }
+
   struct factory_t {
     ore_t ores;
     ore_t robots;
@@ -123,9 +132,13 @@ namespace d19 {
       }
     }
 
-    while (!states.empty()) {
+    for (size_t generation = 0; !states.empty(); ++generation) {
       std::vector<state_t> new_states;
       for (const state_t& s : states) {
+        day_checkpoint([&] {
+          return "generation " + std::to_string(generation) + ", " + std::to_string(states.size() + new_states.size())
+            + " states pending, best so far " + std::to_string(max_geodes) + " geodes";
+        });
         for (minerals_t r : all_minerals) {
           if (r != minerals_t::geode && s.factory.robots[r] >= max_rpm[r]) {
             continue;
@@ -152,25 +165,43 @@ namespace d19 {
     return max_geodes;
   }
 
+  // Geodes of blueprint i, for parallel loops: it takes the stop token of the part, so that its timeout reaches the
+  // blueprints maximized on other threads
+  auto geodes_of(size_t time, const std::vector<blueprints_t>& blueprints) {
+    return [time, &blueprints, &stop = day_stop_token()](size_t i) {
+      auto scope = day_stop_scope(stop);
+      return maximize_geodes(time, blueprints[i]);
+    };
+  }
+
   REGISTER_DAY("d19",
     [](std::istream& input) {
-      std::string line;
-      size_t total = 0;
-      for (size_t i = 1; std::getline(input, line); ++i) {
-        total += i * maximize_geodes(24, parse_blueprint(line));
-      }
+      return parse_blueprints(input);
+    },
+    [](const std::vector<blueprints_t>& blueprints) {
+      auto total = parallel_reduce(blueprints.size(), size_t{ 0 },
+        [geodes = geodes_of(24, blueprints)](size_t i) { return (i + 1) * geodes(i); },
+        std::plus{}, 1);
       return std::to_string(total);
     },
-    [](std::istream& input) {
-      std::string line;
-      size_t total = 1;
-      for (size_t i = 1; std::getline(input, line) && i <= 3; ++i) {
-        total *= maximize_geodes(32, parse_blueprint(line));
-      }
+    [](const std::vector<blueprints_t>& blueprints) {
+      auto total = parallel_reduce(std::min<size_t>(blueprints.size(), 3), size_t{ 1 }, geodes_of(32, blueprints), std::multiplies{}, 1);
       return std::to_string(total);
     }
   )
 
+  REGISTER_GENERATOR("d19", [](std::ostream& out, size_t scale, uint64_t seed) {
+    auto random = random_t(seed);
+    for (size_t i = 1; i <= 30 * scale; ++i) {
+      out << "Blueprint " << i << ":"
+        << " Each ore robot costs " << random.between(2, 4) << " ore."
+        << " Each clay robot costs " << random.between(2, 4) << " ore."
+        << " Each obsidian robot costs " << random.between(2, 4) << " ore and " << random.between(5, 20) << " clay."
+        << " Each geode robot costs " << random.between(2, 4) << " ore and " << random.between(7, 20) << " obsidian.\n";
+    }
+  })
+
+#ifdef AOS_TESTS
   TEST(d19, parsing) {
     blueprints_t b = parse_blueprint("Blueprint 1: Each ore robot costs 4 ore. Each clay robot costs 2 ore. Each obsidian robot costs 3 ore and 14 clay. Each geode robot costs 2 ore and 7 obsidian.");
     EXPECT_EQ(b[minerals_t::ore][minerals_t::ore], 4);
@@ -238,4 +269,17 @@ namespace d19 {
     blueprints_t b2 = parse_blueprint("Blueprint 2: Each ore robot costs 2 ore. Each clay robot costs 3 ore. Each obsidian robot costs 3 ore and 8 clay. Each geode robot costs 3 ore and 12 obsidian.");
     EXPECT_EQ(maximize_geodes(24, b2), 12);
   }
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+  // The argument is the time given, as the search grows with it rather than with the input
+  void d19_maximize_geodes(benchmark::State& state) {
+    auto input = std::istringstream(generated_input("d19", 1));
+    const auto blueprints = parse_blueprints(input);
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(maximize_geodes(state.range(0), blueprints[0]));
+    }
+  }
+  BENCHMARK(d19_maximize_geodes)->DenseRange(16, 24, 4)->Unit(benchmark::kMillisecond);
+#endif
 }
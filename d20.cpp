@@ -1,18 +1,16 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "kernel_bench.hpp"
+#include "tests.hpp"
 
 namespace d20 {
 
   using value_t = int64_t;
   using data_t = std::vector<value_t>;
 
-  data_t parse_data(std::istream& in) {
+  data_t parse_data(std::string_view in) {
     data_t sent;
-    value_t i = 0;
-    for (std::string line; std::getline(in, line); ++i) {
-      sent.push_back(string_view_to<value_t>(line));
-    }
+    for_each_integer<value_t>(in, [&sent](value_t v) { sent.push_back(v); });
     return sent;
   }
 
@@ -69,13 +67,14 @@ namespace d20 {
   }
 
   REGISTER_DAY("d20",
-    [](std::istream& input) {
-      data_t data = parse_data(input);
+    [](std::string_view input) {
+      return parse_data(input);
+    },
+    [](data_t data) {
       mix(data);
       return std::to_string(find_key(data));
     },
-    [](std::istream& input) {
-      data_t data = parse_data(input);
+    [](data_t data) {
       for (value_t& v : data) {
         v *= 811589153;
       }
@@ -84,6 +83,21 @@ namespace d20 {
     }
   )
 
+  // 5000 numbers per scale, with a single 0
+  REGISTER_GENERATOR("d20", [](std::ostream& out, size_t scale, uint64_t seed) {
+    auto random = random_t(seed);
+    const size_t count = 5000 * scale;
+    const size_t zero_at = random.below(count);
+    for (size_t i = 0; i < count; ++i) {
+      value_t value = 0;
+      while (i != zero_at && value == 0) {
+        value = random.between(-10000, 10000);
+      }
+      out << value << '\n';
+    }
+  })
+
+#ifdef AOS_TESTS
   TEST(d20, part1) {
     {
       auto data = data_t{ 1, 2, -3, 3, -2, 0, 4 };
@@ -193,4 +207,19 @@ namespace d20 {
       ASSERT_EQ(data, target);
     }
   }
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+  void d20_mix(benchmark::State& state) {
+    const auto input = generated_input("d20", state.range(0));
+    const auto data = parse_data(input);
+    for (auto _ : state) {
+      auto mixed = data;
+      mix(mixed);
+      benchmark::DoNotOptimize(mixed.data());
+    }
+    state.SetComplexityN(data.size());
+  }
+  BENCHMARK(d20_mix)->RangeMultiplier(2)->Range(1, 4)->Unit(benchmark::kMillisecond)->Complexity();
+#endif
 }
\ No newline at end of file
@@ -1,9 +1,10 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "tests.hpp"
 #include <variant>
 #include <algorithm>
 #include <map>
+#include <utility>
 
 namespace d21 {
 
@@ -26,7 +27,8 @@ namespace d21 {
     return std::visit([&out](const auto& v) -> decltype(auto) { return out << v; }, m);
   }
 
-  using monkey_map_t = std::map<std::string, monkey_t>;
+  // Monkey names fit in the small string buffer, so only the nodes are allocated, in the day memory
+  using monkey_map_t = std::pmr::map<std::string, monkey_t>;
 
   monkey_map_t::value_type parse_monkey(std::string_view line) {
     auto column = line.find(':');
@@ -53,7 +55,7 @@ namespace d21 {
   }
 
   monkey_map_t parse_monkeys(std::istream& in) {
-    monkey_map_t sent;
+    auto sent = monkey_map_t(day_memory());
     for (std::string line; std::getline(in, line);) {
       sent.insert(parse_monkey(line));
     }
@@ -83,7 +85,7 @@ namespace d21 {
   };
 
   using with_unknown_t = std::variant<value_t, operation_t, unknown_t>;
-  using monkey_map_with_unknown_t = std::map<std::string, with_unknown_t>;
+  using monkey_map_with_unknown_t = std::pmr::map<std::string, with_unknown_t>;
 
   static constexpr const char* HUMN = "humn";
 
@@ -164,9 +166,9 @@ namespace d21 {
     }
   }
 
-  value_t solve_humn(std::istream& in) {
-    monkey_map_with_unknown_t m;
-    reduce_branch(parse_monkeys(in), m, "root");
+  value_t solve_humn(const monkey_map_t& monkeys) {
+    auto m = monkey_map_with_unknown_t(day_memory());
+    reduce_branch(monkeys, m, "root");
     auto* op = std::get_if<operation_t>(&m.at("root"));
     if (!op) {
       throw std::runtime_error("tree inconsistency");
@@ -185,17 +187,100 @@ namespace d21 {
     return solve_equality(m, *known, *new_branch);
   }
 
+  value_t solve_humn(std::istream& in) {
+    return solve_humn(parse_monkeys(in));
+  }
+
+  struct generator_t {
+    random_t random;
+    std::vector<std::string> lines;
+    size_t next_name = 0;
+    size_t leaves_left_before_humn;
+
+    std::string new_name() {
+      std::string sent;
+      do {
+        sent.clear();
+        size_t i = next_name++;
+        do {
+          sent.push_back(static_cast<char>('a' + i % 26));
+          i /= 26;
+        } while (sent.size() < 4 || i > 0);
+      } while (sent == "root" || sent == HUMN);
+      return sent;
+    }
+
+    // Makes a monkey yell `value` with `count` monkeys in its tree, `count` being odd, and returns its name.
+    // Values stay strictly positive and operations exact, so that part 2 finds back humn's value
+    std::string generate(value_t value, size_t count) {
+      if (count == 1) {
+        auto name = leaves_left_before_humn-- == 0 ? std::string(HUMN) : new_name();
+        lines.push_back(name + ": " + std::to_string(value));
+        return name;
+      }
+      std::vector<char> ops;
+      if (value >= 2) {
+        ops.push_back('+');
+      }
+      if (value < 1000000000) {
+        ops.push_back('-');
+        ops.push_back('/');
+      }
+      value_t factor = random.between(2, 9);
+      if (value % factor == 0) {
+        ops.push_back('*');
+      }
+      char op = random.pick(ops);
+      value_t left, right;
+      switch (op) {
+      case '+': left = random.between(1, value - 1); right = value - left; break;
+      case '-': right = random.between(1, 100); left = value + right; break;
+      case '*': left = value / factor; right = factor; break;
+      case '/': right = random.between(2, 9); left = value * right; break;
+      default: std::unreachable();
+      }
+      if (op == '*' && random.chance(0.5)) {
+        std::swap(left, right);
+      }
+      auto left_count = 1 + 2 * random.below((count - 1) / 2);
+      auto name = new_name();
+      auto left_name = generate(left, left_count);
+      auto right_name = generate(right, count - 1 - left_count);
+      lines.push_back(name + ": " + left_name + ' ' + op + ' ' + right_name);
+      return name;
+    }
+  };
+
   REGISTER_DAY("d21",
     [](std::istream& in) {
+      return parse_monkeys(in);
+    },
+    [](const monkey_map_t& monkeys) {
       return std::to_string(
-        solve(parse_monkeys(in), "root")
+        solve(monkeys, "root")
       );
     },
-    [](std::istream& in) {
-      return std::to_string(solve_humn(in));
+    [](const monkey_map_t& monkeys) {
+      return std::to_string(solve_humn(monkeys));
     }
   )
 
+  // About 2000 monkeys per scale. Both sides of root yell the same value, humn being one of the leaves
+  REGISTER_GENERATOR("d21", [](std::ostream& out, size_t scale, uint64_t seed) {
+    const size_t side_count = 1000 * scale + 1;
+    auto generator = generator_t{ .random = random_t(seed) };
+    generator.leaves_left_before_humn = generator.random.below(side_count + 1);
+    const value_t value = generator.random.between(1000, 100000);
+    auto left = generator.generate(value, side_count);
+    auto right = generator.generate(value, side_count);
+    generator.lines.push_back("root: " + left + " + " + right);
+    generator.random.shuffle(std::span(generator.lines));
+    for (const std::string& line : generator.lines) {
+      out << line << '\n';
+    }
+  })
+
+#ifdef AOS_TESTS
   TEST(d21, parse_monkey) {
     {
       auto m = parse_monkey("root: pppw + sjmn");
@@ -345,4 +430,5 @@ hmdt: 32
     in.get();
     ASSERT_EQ(solve_humn(in), 301);
   }
+#endif
 }
\ No newline at end of file
@@ -1,8 +1,10 @@
 #include "days.hpp"
 #include "utils.hpp"
-#include <gtest/gtest.h>
+#include "tests.hpp"
 #include <algorithm>
 #include <queue>
+#include <cassert>
+#include <utility>
 
 namespace d22 {
 
@@ -214,10 +216,17 @@ namespace d22 {
     explicit map_t(std::istream& in, dim_t face_size)
       : m_face_size(face_size)
     {
+      std::vector<std::string> lines;
       for (std::string line; std::getline(in, line) && !line.empty();) {
-        m_map.push_back(std::move(line));
-        m_map_width = std::max(m_map_width, static_cast<dim_t>(m_map.back().size()));
+        lines.push_back(std::move(line));
       }
+      m_map = grid2d<cell_t>::from_lines(lines, [](char c) {
+        switch (c) {
+        case '#': return cell_t::wall;
+        case '.': return cell_t::path;
+        default: return cell_t::empty;
+        }
+      }, cell_t::empty, 1, cell_t::empty);
       auto first_pos = pos_t{ 0, 0 };
       while (at(first_pos) == cell_t::empty)
         first_pos.x += m_face_size;
@@ -246,20 +255,14 @@ namespace d22 {
       }
     }
 
+    // Without bounds check: `p` is on the map or next to it
     cell_t operator[](const pos_t& p) const {
-      return at(p);
+      return m_map(p.x, p.y);
     }
 
+    // Anywhere, empty off the map
     cell_t at(const pos_t& p) const {
-      if (p.y < 0 || p.y >= map_height()
-        || p.x < 0 || p.x >= static_cast<dim_t>(m_map[p.y].size())) {
-        return cell_t::empty;
-      }
-      switch (m_map[p.y][p.x]) {
-      case '#': return cell_t::wall;
-      case '.': return cell_t::path;
-      default: return cell_t::empty;
-      }
+      return m_map.contains(p.x, p.y) ? m_map(p.x, p.y) : cell_t::empty;
     }
 
     const face_t& face_at(const pos_t& p) const {
@@ -284,12 +287,12 @@ namespace d22 {
     }
 
     dim_t face_size() const { return m_face_size; }
-    dim_t map_height() const { return static_cast<dim_t>(m_map.size()); }
-    dim_t map_width() const { return m_map_width; }
+    dim_t map_height() const { return static_cast<dim_t>(m_map.height()); }
+    dim_t map_width() const { return static_cast<dim_t>(m_map.width()); }
 
   private:
-    std::vector<std::string> m_map;
-    dim_t m_map_width = 0;
+    // Bordered by empty cells, the steps off the map
+    grid2d<cell_t> m_map;
     dim_t m_face_size = 0;
 
     std::vector<absolute_face_t> m_faces;
@@ -301,7 +304,7 @@ namespace d22 {
 
     static you_t from_map(const map_t& map) {
       pos_t pos;
-      while (map[pos] == cell_t::empty) {
+      while (map.at(pos) == cell_t::empty) {
         pos.x += map.face_size();
       }
       while (map[pos] == cell_t::wall) {
@@ -324,7 +327,7 @@ namespace d22 {
         pos_t next = pos + dir_vec;
         if (map[next] == cell_t::empty) {
           next -= 6 * map.face_size() * dir_vec;
-          while (map[next] == cell_t::empty) {
+          while (map.at(next) == cell_t::empty) {
             next += map.face_size() * dir_vec;
           }
         }
@@ -419,6 +422,29 @@ namespace d22 {
     [](std::istream& in) { return d22(in, &you_t::advance_fold); }
   )
 
+  // The solver is bound to faces of 50, so the map keeps the shape of real inputs and only the path grows, by 2000 moves per scale
+  REGISTER_GENERATOR("d22", [](std::ostream& out, size_t scale, uint64_t seed) {
+    static constexpr dim_t face_size = 50;
+    static constexpr std::string_view layout[] = { " ##", " #", "##", "#" };
+    auto random = random_t(seed);
+    for (std::string_view faces : layout) {
+      for (dim_t y = 0; y < face_size; ++y) {
+        for (char face : faces) {
+          for (dim_t x = 0; x < face_size; ++x) {
+            out << (face == ' ' ? ' ' : (random.chance(0.05) && y + x > 0) ? '#' : '.');
+          }
+        }
+        out << '\n';
+      }
+    }
+    out << '\n';
+    for (size_t i = 0; i < 2000 * scale; ++i) {
+      out << random.between(1, 50) << random.pick("RL");
+    }
+    out << random.between(1, 50) << '\n';
+  })
+
+#ifdef AOS_TESTS
     TEST(d22, parsing) {
 
     EXPECT_EQ(face_next_to(6, dir::right), face_t(4, 1));
@@ -575,4 +601,5 @@ namespace d22 {
     }
     ASSERT_EQ(visitor.you().password(), 5031);
   }
+#endif
 }
\ No newline at end of file
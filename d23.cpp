@@ -1,7 +1,13 @@
 #include "days.hpp"
-#include <gtest/gtest.h>
-#include <set>
+#include "utils.hpp"
+#include "kernel_bench.hpp"
+#include "tests.hpp"
 #include <array>
+#include <sstream>
+#ifdef AOS_KERNEL_BENCH
+#include <map>
+#include <set>
+#endif
 
 namespace d23 {
 
@@ -18,6 +24,10 @@ namespace d23 {
     auto operator<=>(const pos_t&) const = default;
   };
 
+  uint64_t pack_key(const pos_t& p) {
+    return pack_coords(p.x, p.y);
+  }
+
   std::ostream& operator<<(std::ostream& out, const pos_t& p) {
     return out << '(' << p.x << ", " << p.y << ')';
   }
@@ -40,10 +50,10 @@ namespace d23 {
     return { .x = l.x + r.x, .y = l.y + r.y };
   }
 
-  using elves_t = std::set<pos_t>;
+  using elves_t = flat_hash_set<pos_t>;
 
   elves_t parse_elves(std::istream& input) {
-    elves_t sent;
+    auto sent = elves_t(day_memory());
     dist_t y = 0;
     for (std::string line; std::getline(input, line) && !line.empty(); ++y) {
       for (size_t x = 0; x < line.size(); ++x) {
@@ -102,53 +112,70 @@ namespace d23 {
     uint8_t m_count = 0;
   };
 
-  std::pair<elves_t, bool> move_elves(const elves_t& elves, std::span<const dir_t> dir_order) {
-    // Step 1: suggestions
-    std::map<pos_t, pos_t> suggestion;
-    std::map<pos_t, size_t> counts;
-    for (const pos_t& e : elves) {
-      neighbor_tracker_t neighbor_tracker;
-      for (dir_t dir : all_dirs) {
-        if (elves.contains(e + vec_from_dir(dir))) {
-          neighbor_tracker.track(dir);
-        }
+  // Where the elf at `e` suggests to go
+  template<typename Set>
+  pos_t suggest_move(const Set& elves, const pos_t& e, std::span<const dir_t> dir_order) {
+    neighbor_tracker_t neighbor_tracker;
+    for (dir_t dir : all_dirs) {
+      if (elves.contains(e + vec_from_dir(dir))) {
+        neighbor_tracker.track(dir);
       }
-      auto slot = suggestion.emplace(e, e).first;
-      if (!neighbor_tracker.is_empty()) {
-        for (dir_t d : dir_order) {
-          if (neighbor_tracker.count_for(d) == 0) {
-            slot->second += vec_from_dir(d);
-            break;
-          }
+    }
+    if (!neighbor_tracker.is_empty()) {
+      for (dir_t d : dir_order) {
+        if (neighbor_tracker.count_for(d) == 0) {
+          return e + vec_from_dir(d);
         }
       }
-      auto [count_slot, inserted] = counts.try_emplace(slot->second, 1);
-      if (!inserted) { ++count_slot->second; }
+    }
+    return e;
+  }
+
+  // The new elves, and the scratch buffers, are allocated from the resource of `elves`. `Set` and `Map` are only other
+  // than the flat hash ones in the benchmark against the std::pmr ones they replaced
+  template<typename Set = elves_t, typename Map = flat_hash_map<pos_t, size_t>>
+  std::pair<Set, bool> move_elves(const Set& elves, std::span<const dir_t> dir_order) {
+    // Step 1: suggestions, made in parallel as they only read `elves`
+    auto from = std::pmr::vector<pos_t>(elves.begin(), elves.end(), elves.get_allocator());
+    auto to = std::pmr::vector<pos_t>(from.size(), elves.get_allocator());
+    parallel_for(from.size(), [&](size_t i) {
+      to[i] = suggest_move(elves, from[i], dir_order);
+    });
+    auto counts = Map(elves.get_allocator().resource());
+    if constexpr (requires { counts.reserve(elves.size()); }) {
+      counts.reserve(elves.size());
+    }
+    for (const pos_t& t : to) {
+      ++counts[t];
     }
 
     // Step 2: moves
-    elves_t sent;
+    auto sent = Set(elves.get_allocator().resource());
+    if constexpr (requires { sent.reserve(elves.size()); }) {
+      sent.reserve(elves.size());
+    }
     bool moved = false;
-    for (const auto& [from, to] : suggestion) {
-      if (counts.at(to) == 1) {
-        sent.insert(to);
-        if (to != from) { moved = true; }
+    for (size_t i = 0; i < from.size(); ++i) {
+      if (counts.at(to[i]) == 1) {
+        sent.insert(to[i]);
+        if (to[i] != from[i]) { moved = true; }
       } else {
-        sent.insert(from);
+        sent.insert(from[i]);
       }
     }
-    return { sent, moved };
+    return { std::move(sent), moved };
   }
 
   class runner_t {
   public:
-    explicit runner_t(elves_t initial_state)
-      : m_elves(std::move(initial_state))
+    explicit runner_t(const elves_t& initial_state)
+      : m_elves(initial_state, &m_pool)
     {}
 
     const elves_t& elves() const { return m_elves; }
 
     bool tick() {
+      AOS_TRACE_SCOPE("tick");
       auto [new_elves, moved] = move_elves(m_elves, m_dirs);
       m_elves = std::move(new_elves);
       std::rotate(m_dirs.begin(), m_dirs.begin() + 1, m_dirs.end());
@@ -156,6 +183,9 @@ namespace d23 {
     }
 
     dist_t empty_region() const {
+      if (m_elves.empty()) {
+        return 0;
+      }
       pos_t min = *m_elves.begin();
       pos_t max = *m_elves.begin();
       for (const pos_t& e : m_elves) {
@@ -168,28 +198,46 @@ namespace d23 {
     }
 
   private:
+    // Every tick frees the previous elves, the pool recycles their nodes instead of growing the day memory
+    std::pmr::unsynchronized_pool_resource m_pool{ day_memory() };
     elves_t m_elves;
     std::array<dir_t, 4> m_dirs{ N, S, W, E };
   };
 
   REGISTER_DAY("d23",
     [](std::istream& in) {
-      auto runner = runner_t(parse_elves(in));
+      return parse_elves(in);
+    },
+    [](const elves_t& elves) {
+      auto runner = runner_t(elves);
       for (int i = 0; i < 10; ++i) {
         runner.tick();
       }
       return std::to_string(runner.empty_region());
     },
-    [](std::istream& in) {
-      auto runner = runner_t(parse_elves(in));
+    [](const elves_t& elves) {
+      auto runner = runner_t(elves);
       size_t count = 1;
       while (runner.tick()) {
+        day_checkpoint([count] { return std::to_string(count) + " rounds played"; });
         ++count;
       }
       return std::to_string(count);
     }
   );
 
+  REGISTER_GENERATOR("d23", [](std::ostream& out, size_t scale, uint64_t seed) {
+    auto random = random_t(seed);
+    const size_t side = scaled_side(72, scale, 2);
+    for (size_t y = 0; y < side; ++y) {
+      for (size_t x = 0; x < side; ++x) {
+        out << (random.chance(0.5) ? '#' : '.');
+      }
+      out << '\n';
+    }
+  })
+
+#ifdef AOS_TESTS
   TEST(d23, parsing) {
     auto in = std::istringstream(R"(
 .....
@@ -251,6 +299,7 @@ namespace d23 {
       runner.tick();
     }
     ASSERT_EQ(runner.empty_region(), 110);
+    ASSERT_EQ(runner_t(elves_t()).empty_region(), 0);
   }
 
   TEST(d23, part2) {
@@ -276,4 +325,50 @@ namespace d23 {
     }
     ASSERT_EQ(count, 20);
   }
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+  void d23_move_elves(benchmark::State& state) {
+    auto input = std::istringstream(generated_input("d23", state.range(0)));
+    const auto elves = parse_elves(input);
+    static constexpr dir_t dir_order[] = { N, S, W, E };
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(move_elves(elves, dir_order));
+    }
+    state.SetItemsProcessed(state.iterations() * elves.size());
+    state.SetComplexityN(elves.size());
+  }
+  BENCHMARK(d23_move_elves)->RangeMultiplier(4)->Range(1, 64)->Unit(benchmark::kMillisecond)->Complexity();
+
+  // A round in the elves set and suggestion counts against the std::pmr ones they replaced
+  template<typename Set, typename Map>
+  void d23_move_elves_containers(benchmark::State& state) {
+    auto input = std::istringstream(generated_input("d23", state.range(0)));
+    auto elves = Set(std::pmr::get_default_resource());
+    for (const pos_t& e : parse_elves(input)) {
+      elves.insert(e);
+    }
+    static constexpr dir_t dir_order[] = { N, S, W, E };
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(move_elves<Set, Map>(elves, dir_order));
+    }
+    state.SetItemsProcessed(state.iterations() * elves.size());
+  }
+  BENCHMARK_TEMPLATE(d23_move_elves_containers, std::pmr::set<pos_t>, std::pmr::map<pos_t, size_t>)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMillisecond);
+  BENCHMARK_TEMPLATE(d23_move_elves_containers, elves_t, flat_hash_map<pos_t, size_t>)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMillisecond);
+
+  // Speedup of the parallel suggestions, the second argument being the thread count
+  void d23_move_elves_threads(benchmark::State& state) {
+    auto input = std::istringstream(generated_input("d23", state.range(0)));
+    const auto elves = parse_elves(input);
+    static constexpr dir_t dir_order[] = { N, S, W, E };
+    set_parallelism(state.range(1));
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(move_elves(elves, dir_order));
+    }
+    set_parallelism(std::max(std::thread::hardware_concurrency(), 1u));
+    state.SetItemsProcessed(state.iterations() * elves.size());
+  }
+  BENCHMARK(d23_move_elves_threads)->ArgsProduct({ { 16 }, { 1, 2, 4, 8 } })->Unit(benchmark::kMillisecond)->UseRealTime();
+#endif
 }
\ No newline at end of file
@@ -1,7 +1,13 @@
 #include "days.hpp"
-#include <gtest/gtest.h>
+#include "utils.hpp"
+#include "kernel_bench.hpp"
+#include "tests.hpp"
 #include <ranges>
 #include <algorithm>
+#include <cassert>
+#include <set>
+#include <sstream>
+#include <utility>
 
 namespace d24 {
 
@@ -121,13 +127,12 @@ namespace d24 {
 
     static map_t from_stream(std::istream& in) {
       map_t sent;
-      for (std::string line; std::getline(in, line) && !line.empty(); ++sent.m_height) {
-        assert(sent.m_width == 0 || sent.m_width == static_cast<dist_t>(line.size()));
-        sent.m_width = static_cast<dist_t>(line.size());
-        for (char c : line) {
-          sent.m_cells.push_back(cell_t::from_char(c));
-        }
+      std::vector<std::string> lines;
+      for (std::string line; std::getline(in, line) && !line.empty();) {
+        assert(lines.empty() || lines.front().size() == line.size());
+        lines.push_back(std::move(line));
       }
+      sent.m_cells = grid2d<cell_t>::from_lines(lines, cell_t::from_char, cell_t::empty, 1, cell_t::wall);
       sent.m_start = { .x = 1, .y = 0 };
       assert(sent[sent.m_start] == cell_t::empty);
       sent.m_end = { .x = sent.width() - 2, .y = sent.height() - 1};
@@ -135,33 +140,37 @@ namespace d24 {
       return sent;
     }
 
-    template<typename Self>
-    auto&& at(this Self&& self, const pos_t& pos) {
-      assert(pos.x >= 0 && pos.x < self.m_width && pos.y >= 0 && pos.y < self.m_height);
-      return std::forward<Self>(self).m_cells.at(pos.y * self.m_width + pos.x);
+    // Also one cell off the map, in the wall around it
+    const cell_t& at(const pos_t& pos) const {
+      return m_cells(pos.x, pos.y);
     }
 
-    template<typename Self>
-    auto&& operator[](this Self&& self, const pos_t& pos) {
-      return std::forward<Self>(self).at(pos);
+    cell_t& at(const pos_t& pos) {
+      return const_cast<cell_t&>(std::as_const(*this).at(pos));
     }
 
-    dist_t width() const { return m_width; }
-    dist_t height() const { return m_height; }
+    const cell_t& operator[](const pos_t& pos) const { return at(pos); }
+    cell_t& operator[](const pos_t& pos) { return at(pos); }
+    const cell_t& operator[](size_t i) const { return m_cells[static_cast<index_t>(i)]; }
+
+    using index_t = grid2d_layout::index_t;
+    const grid2d_layout& layout() const { return m_cells; }
+    size_t index_of(const pos_t& pos) const { return static_cast<size_t>(m_cells.index_of(pos.x, pos.y)); }
+
+    dist_t width() const { return static_cast<dist_t>(m_cells.width()); }
+    dist_t height() const { return static_cast<dist_t>(m_cells.height()); }
     pos_t start() const { return m_start; }
     pos_t end() const { return m_end; }
 
     auto operator<=>(const map_t&) const = default;
 
     void clear_wind() {
-      for (cell_t& c : m_cells) {
+      for (cell_t& c : m_cells.cells()) {
         c.winds.clear();
       }
     }
 
     friend void swap(map_t& l, map_t& r) {
-      std::swap(l.m_width, r.m_width);
-      std::swap(l.m_height, r.m_height);
       std::swap(l.m_cells, r.m_cells);
     }
 
@@ -170,9 +179,7 @@ namespace d24 {
 
     pos_t m_start;
     pos_t m_end;
-    dist_t m_width = 0;
-    dist_t m_height = 0;
-    std::vector<cell_t> m_cells;
+    grid2d<cell_t> m_cells;
   };
 
   struct vec_t {
@@ -210,6 +217,7 @@ namespace d24 {
     }
 
     void move() {
+      AOS_TRACE_SCOPE("move");
       m_buffer.clear_wind();
       for (auto p = pos_t{ 0, 0 }; p.x < width() && p.y < height(); p = advance(p, width())) {
         cell_t source = at(p);
@@ -239,32 +247,33 @@ namespace d24 {
     map_t m_buffer;
   };
 
-  auto solve_fastest(moving_map_t& map, pos_t from, pos_t to) {
-    auto to_visit = std::set<pos_t>{ from };
-    for (size_t count = 1; true; ++count) {
-      std::set<pos_t> new_pos;
-      auto check_add = [&](pos_t p) {
-        if (p.x >= 0 && p.x < map.width()
-          && p.y >= 0 && p.y < map.height()
-          && map[p] == cell_t::empty
-          ) {
-          new_pos.insert(p);
+  // Positions next to the entrance and the exit are in the wall around the map, waiting is a move
+  size_t solve_fastest(moving_map_t& map, pos_t from, pos_t to) {
+    const auto offsets = map.layout().neighbor_offsets();
+    const size_t sources[] = { map.index_of(from) };
+    auto bfs = bfs_engine();
+    auto found = bfs.search(map.layout().buffer_size(), sources,
+      [&](size_t cur, auto&& emit) {
+        if (map[cur] == cell_t::empty) {
+          emit(cur);
         }
-      };
-
-      map.move();
-      for (pos_t p : to_visit) {
-        check_add(p);
-        for (dir_t d : cardinal_dirs) {
-          pos_t next = p + vec_t::from_dir(d);
-          if (next == to) {
-            return count;
+        for (moving_map_t::index_t offset : offsets) {
+          if (map[cur + offset] == cell_t::empty) {
+            emit(cur + offset);
           }
-          check_add(next);
         }
+      },
+      [goal = map.index_of(to)](size_t p) { return p == goal; },
+      bfs_engine::revisit::each_layer,
+      [&](size_t minute) {
+        day_checkpoint([&] { return "minute " + std::to_string(minute) + ", " + std::to_string(bfs.frontier().size()) + " positions reached"; });
+        map.move();
       }
-      to_visit = std::move(new_pos);
+    );
+    if (!found) {
+      throw std::runtime_error("no path through the blizzards");
     }
+    return *found;
   }
 
   auto solve_fastest(moving_map_t map) {
@@ -273,10 +282,12 @@ namespace d24 {
 
   REGISTER_DAY("d24",
     [](std::istream& in) {
-      return std::to_string(solve_fastest(moving_map_t::from_stream(in)));
+      return moving_map_t::from_stream(in);
     },
-    [](std::istream& in) {
-      auto map = moving_map_t::from_stream(in);
+    [](const moving_map_t& map) {
+      return std::to_string(solve_fastest(map));
+    },
+    [](moving_map_t map) {
       auto time = solve_fastest(map, map.start(), map.end());
       time += solve_fastest(map, map.end(), map.start());
       time += solve_fastest(map, map.start(), map.end());
@@ -284,6 +295,29 @@ namespace d24 {
     }
   )
 
+  // No vertical blizzard shares a column with the entrance or the exit, as they would blow through them
+  REGISTER_GENERATOR("d24", [](std::ostream& out, size_t scale, uint64_t seed) {
+    auto random = random_t(seed);
+    const size_t width = scaled_side(120, scale, 2) + 2;
+    const size_t height = scaled_side(25, scale, 2) + 2;
+    out << "#." << std::string(width - 2, '#') << '\n';
+    for (size_t y = 1; y < height - 1; ++y) {
+      out << '#';
+      for (size_t x = 1; x < width - 1; ++x) {
+        if (!random.chance(0.5)) {
+          out << '.';
+        } else if (x == 1 || x == width - 2) {
+          out << random.pick("<>");
+        } else {
+          out << random.pick("<>^v");
+        }
+      }
+      out << "#\n";
+    }
+    out << std::string(width - 2, '#') << ".#\n";
+  })
+
+#ifdef AOS_TESTS
   TEST(d24, parsing) {
     auto in = std::istringstream(R"(
 #.######
@@ -411,4 +445,17 @@ namespace d24 {
     EXPECT_EQ(solve_fastest(map, map.end(), map.start()), 23);
     EXPECT_EQ(solve_fastest(map, map.start(), map.end()), 13);
   }
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+  void d24_move(benchmark::State& state) {
+    auto input = std::istringstream(generated_input("d24", state.range(0)));
+    auto map = moving_map_t::from_stream(input);
+    for (auto _ : state) {
+      map.move();
+    }
+    state.SetItemsProcessed(state.iterations() * map.width() * map.height());
+  }
+  BENCHMARK(d24_move)->RangeMultiplier(4)->Range(1, 64);
+#endif
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "days.hpp"
-#include <gtest/gtest.h>
+#include "utils.hpp"
+#include "tests.hpp"
 #include <algorithm>
+#include <ranges>
+#include <utility>
 
 namespace d25 {
   using value_t = int64_t;
@@ -60,15 +63,32 @@ namespace d25 {
   }
 
   REGISTER_DAY("d25",
-    [](std::istream& in) {
+    [](std::string_view in) {
       value_t res = 0;
-      for (std::string line; std::getline(in, line);) {
+      for (std::string_view line : lines(in)) {
         res += snafu_value(line);
       }
       return value_snafu(res);
     }
   )
 
+  REGISTER_GENERATOR("d25", [](std::ostream& out, size_t scale, uint64_t seed) {
+    auto random = random_t(seed);
+    for (size_t i = 0; i < 120 * scale; ++i) {
+      out << value_snafu(random.between(1, 10000000000000)) << '\n';
+    }
+  })
+
+  REGISTER_LINE_STREAM("d25", value_t,
+    [](value_t& sum, std::string_view line) {
+      sum += snafu_value(line);
+    },
+    [](value_t sum) {
+      return value_snafu(sum);
+    }
+  )
+
+#ifdef AOS_TESTS
   TEST(d25, snafu_value) {
     std::pair<value_t, std::string_view> tests[]{
       { 1, "1" },
@@ -93,4 +113,5 @@ namespace d25 {
     }
     EXPECT_EQ(snafu_value("2=-01"), 976);
   }
+#endif
 }
\ No newline at end of file
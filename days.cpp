@@ -1,14 +1,207 @@
 #include "days.hpp"
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
+#include <spanstream>
+#include <sstream>
+#include "tests.hpp"
 
 std::vector<day> g_days;
+thread_local std::pmr::memory_resource* t_day_memory = nullptr;
+thread_local const std::stop_token* t_day_stop = nullptr;
+
+std::pmr::memory_resource* day_memory()
+{
+  return t_day_memory ? t_day_memory : std::pmr::get_default_resource();
+}
+
+day_memory_scope::day_memory_scope(std::pmr::memory_resource* memory)
+  : m_previous(t_day_memory)
+{
+  t_day_memory = memory;
+}
+
+day_memory_scope::~day_memory_scope()
+{
+  t_day_memory = m_previous;
+}
+
+const std::stop_token& day_stop_token()
+{
+  static const auto never = std::stop_token();
+  return t_day_stop ? *t_day_stop : never;
+}
+
+day_stop_scope::day_stop_scope(std::stop_token token)
+  : m_token(std::move(token))
+  , m_previous(t_day_stop)
+{
+  t_day_stop = &m_token;
+}
+
+day_stop_scope::~day_stop_scope()
+{
+  t_day_stop = m_previous;
+}
+
+std::string day_part::operator()(std::string_view input) const
+{
+  if (view) {
+    return view(input);
+  }
+  if (!this->stream) {
+    throw std::logic_error("Part only takes a parsed model, call it with the day_input of day::prepare");
+  }
+  auto stream = std::ispanstream(std::span<const char>(input.data(), input.size()));
+  return this->stream(stream);
+}
+
+std::string day_part::operator()(const day_input& input) const
+{
+  if (parsed) {
+    return parsed(input.model);
+  }
+  return (*this)(input.raw);
+}
+
+std::string day_part::operator()(const day_input& input, std::stop_token stop) const
+{
+  auto scope = day_stop_scope(std::move(stop));
+  return (*this)(input);
+}
+
+day_input day::prepare(std::string_view raw) const
+{
+  auto sent = day_input{ .raw = raw };
+  if (parse) {
+    sent.model = parse(raw);
+  }
+  return sent;
+}
+
+void register_day(day d)
+{
+  g_days.push_back(d);
+}
 
 void register_day(const char* name, day_function part1, day_function part2)
 {
-  g_days.push_back(day{ name, part1, part2 });
+  register_day(day{ name, { .stream = part1 }, { .stream = part2 } });
+}
+
+void register_day(const char* name, day_view_function part1, day_view_function part2)
+{
+  register_day(day{ name, { .view = part1 }, { .view = part2 } });
+}
+
+void register_generator(const char* name, generate_function generate)
+{
+  auto found = std::ranges::find_if(g_days, [name](const day& d) { return std::string_view(d.name) == name; });
+  if (found == g_days.end()) {
+    throw std::logic_error(std::string("generator registered before day ") + name);
+  }
+  found->generate = generate;
+}
+
+void register_stream(const char* name, day_stream stream)
+{
+  auto found = std::ranges::find_if(g_days, [name](const day& d) { return std::string_view(d.name) == name; });
+  if (found == g_days.end()) {
+    throw std::logic_error(std::string("stream registered before day ") + name);
+  }
+  found->stream = std::move(stream);
 }
 
 std::span<const day> all_days()
 {
   return g_days;
 }
+
+const day* find_day(std::string_view name)
+{
+  auto found = std::ranges::find_if(g_days, [name](const day& d) { return d.name == name; });
+  return found == g_days.end() ? nullptr : &*found;
+}
+
+#ifdef AOS_TESTS
+TEST(days, day_memory) {
+  EXPECT_EQ(day_memory(), std::pmr::get_default_resource());
+  {
+    auto arena = day_arena();
+    auto* outer = day_memory();
+    EXPECT_NE(outer, std::pmr::get_default_resource());
+    {
+      auto nested = day_arena();
+      EXPECT_NE(day_memory(), outer);
+    }
+    EXPECT_EQ(day_memory(), outer);
+  }
+  EXPECT_EQ(day_memory(), std::pmr::get_default_resource());
+}
+
+TEST(days, stop_token) {
+  EXPECT_FALSE(day_stop_token().stop_possible());
+  auto stop = std::stop_source();
+  {
+    auto scope = day_stop_scope(stop.get_token());
+    EXPECT_NO_THROW(day_checkpoint([] { return "not stopped"; }));
+    stop.request_stop();
+    try {
+      day_checkpoint([] { return std::string("halfway"); });
+      FAIL() << "no day_cancelled";
+    } catch (const day_cancelled& e) {
+      EXPECT_STREQ(e.what(), "halfway");
+    }
+  }
+  EXPECT_NO_THROW(day_checkpoint([] { return "outside"; }));
+}
+
+// One-pass forms give the answers of the parts, whatever the size of the chunks they are fed
+TEST(days, streams) {
+  for (const day& d : all_days()) {
+    if (!d.stream) {
+      continue;
+    }
+    ASSERT_TRUE(d.generate) << d.name;
+    auto generated = std::ostringstream();
+    d.generate(generated, 1, 42);
+    const std::string input = std::move(generated).str();
+    const day_input model = d.prepare(input);
+    const std::string expected[] = { d.part1(model), d.part2 ? d.part2(model) : "" };
+    // The last one without its newline
+    const auto unterminated = std::string_view(input).substr(0, input.size() - input.ends_with('\n'));
+    for (auto [fed, chunk] : { std::pair(std::string_view(input), size_t{ 1 }), std::pair(std::string_view(input), size_t{ 7 }),
+      std::pair(std::string_view(input), size_t{ 4096 }), std::pair(unterminated, unterminated.size()) }) {
+      std::any state = d.stream.initial;
+      for (size_t i = 0; i < fed.size(); i += chunk) {
+        d.stream.feed(state, fed.substr(i, chunk));
+      }
+      if (d.stream.finish) {
+        d.stream.finish(state);
+      }
+      EXPECT_EQ(d.stream.part1(state), expected[0]) << d.name << " by " << chunk;
+      EXPECT_EQ(d.stream.part2 ? d.stream.part2(state) : "", expected[1]) << d.name << " by " << chunk;
+    }
+  }
+}
+
+TEST(days, parsed_part_on_raw_input) {
+  const day* d = find_day("d12");
+  ASSERT_TRUE(d && d->parse && d->part1.parsed);
+  EXPECT_THROW(d->part1(std::string_view("S.E\n")), std::logic_error);
+}
+
+TEST(days, generators) {
+  for (const day& d : all_days()) {
+    if (!d.generate) {
+      continue;
+    }
+    auto first = std::ostringstream();
+    auto second = std::ostringstream();
+    d.generate(first, 1, 42);
+    d.generate(second, 1, 42);
+    EXPECT_EQ(first.str(), second.str()) << d.name;
+    EXPECT_NO_THROW(d.prepare(first.str())) << d.name;
+  }
+}
+#endif
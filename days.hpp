@@ -1,18 +1,241 @@
 #pragma once
 
+#include <any>
+#include <cstddef>
 #include <iostream>
+#include <memory_resource>
+#include <spanstream>
 #include <string>
+#include <string_view>
 #include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <type_traits>
 
 using day_function = std::string(*)(std::istream&);
+using day_view_function = std::string(*)(std::string_view);
+using parse_function = std::any(*)(std::string_view);
+using parsed_day_function = std::string(*)(const std::any&);
+// Writes an input about `scale` times the size of a real one, always the same for a given seed
+using generate_function = void(*)(std::ostream& out, size_t scale, uint64_t seed);
+
+// Memory resource the days build their containers on: the one of the innermost live
+// day_memory_scope of the calling thread, or the default resource outside of any
+std::pmr::memory_resource* day_memory();
+
+// Makes `memory` the day memory of the calling thread for its lifetime
+class day_memory_scope {
+public:
+  explicit day_memory_scope(std::pmr::memory_resource* memory);
+  ~day_memory_scope();
+
+  day_memory_scope(const day_memory_scope&) = delete;
+  day_memory_scope& operator=(const day_memory_scope&) = delete;
+
+private:
+  std::pmr::memory_resource* m_previous;
+};
+
+// Monotonic arena serving as the day memory while it lives, what was allocated in it is freed at once with it.
+// Runs give one to the parse stage, kept as long as its model, and a fresh one to each run of a part
+class day_arena {
+public:
+  day_arena() = default;
+  // Starts in `buffer`, then gets more from `upstream`
+  day_arena(void* buffer, size_t size, std::pmr::memory_resource* upstream)
+    : m_arena(buffer, size, upstream)
+  {}
+
+private:
+  std::pmr::monotonic_buffer_resource m_arena;
+  day_memory_scope m_scope{ &m_arena };
+};
+
+// Thrown by day_checkpoint once the part running on the calling thread is asked to stop, with how far it got
+class day_cancelled : public std::runtime_error {
+public:
+  using std::runtime_error::runtime_error;
+};
+
+// Stop token of the innermost live day_stop_scope of the calling thread, one that is never stopped outside of any
+const std::stop_token& day_stop_token();
+
+// Makes `token` the day stop token of the calling thread for its lifetime
+class day_stop_scope {
+public:
+  explicit day_stop_scope(std::stop_token token);
+  ~day_stop_scope();
+
+  day_stop_scope(const day_stop_scope&) = delete;
+  day_stop_scope& operator=(const day_stop_scope&) = delete;
+
+private:
+  std::stop_token m_token;
+  const std::stop_token* m_previous;
+};
+
+// Cancellation point of the outer loops of long solvers: throws day_cancelled with the description returned by
+// `progress`, only called then, once the running part is asked to stop. Parts without any run to their end
+template<typename Progress>
+void day_checkpoint(Progress&& progress) {
+  if (day_stop_token().stop_requested()) {
+    throw day_cancelled(progress());
+  }
+}
+
+// What the parts of a day are fed with: the raw input, plus the model for days with a parse stage
+struct day_input {
+  std::string_view raw;
+  std::any model;
+};
+
+struct day_part {
+  day_function stream = nullptr;
+  day_view_function view = nullptr;
+  parsed_day_function parsed = nullptr;
+
+  explicit operator bool() const { return stream || view || parsed; }
+
+  // Prefers the view overload, falls back to streaming over `input` without copying it. Throws std::logic_error for
+  // parts only taking a parsed model
+  std::string operator()(std::string_view input) const;
+  // Same, but hands over the parsed model when there is one
+  std::string operator()(const day_input& input) const;
+  // Same, with `stop` as the day stop token: throws day_cancelled once it is requested and the part reaches a checkpoint
+  std::string operator()(const day_input& input, std::stop_token stop) const;
+};
+
+// One-pass form of a day, fed its input as it arrives instead of once it is whole
+struct day_stream {
+  // Copied for each input
+  std::any initial;
+  // Takes the next bytes of the input, cut anywhere
+  void (*feed)(std::any& state, std::string_view bytes) = nullptr;
+  // Called once the input ended, before the parts answer
+  void (*finish)(std::any& state) = nullptr;
+  std::string (*part1)(const std::any& state) = nullptr;
+  std::string (*part2)(const std::any& state) = nullptr;
+
+  explicit operator bool() const { return feed != nullptr; }
+};
 
 struct day {
   const char* name;
-  day_function part1;
-  day_function part2;
+  day_part part1;
+  day_part part2;
+  // When set, both parts take the model built by it instead of the raw input
+  parse_function parse = nullptr;
+  generate_function generate = nullptr;
+  // Optional, answers like the parts do
+  day_stream stream;
+
+  // Runs the parse stage if any
+  day_input prepare(std::string_view raw) const;
 };
 
+void register_day(day d);
 void register_day(const char* name, day_function part1 = nullptr, day_function part2 = nullptr);
+void register_day(const char* name, day_view_function part1, day_view_function part2 = nullptr);
+
+// Registers a day whose input is parsed once and shared by both parts.
+// `Parse` takes either a std::string_view or a std::istream& and returns the model,
+// each part takes the model by const reference, or by value when it needs its own copy.
+// All three must be captureless lambdas.
+template<typename Parse, typename Part1, typename Part2>
+void register_day(const char* name, Parse, Part1, Part2) {
+  static_assert(std::is_default_constructible_v<Parse> && std::is_default_constructible_v<Part1> && std::is_default_constructible_v<Part2>,
+    "parse stage and parts must be captureless lambdas");
+
+  constexpr bool parse_view = std::is_invocable_v<Parse, std::string_view>;
+  using model_t = std::remove_cvref_t<std::invoke_result_t<Parse, std::conditional_t<parse_view, std::string_view, std::istream&>>>;
+
+  register_day(day{
+    .name = name,
+    .part1 = { .parsed = [](const std::any& model) -> std::string { return Part1{}(std::any_cast<const model_t&>(model)); } },
+    .part2 = { .parsed = [](const std::any& model) -> std::string { return Part2{}(std::any_cast<const model_t&>(model)); } },
+    .parse = [](std::string_view input) -> std::any {
+      if constexpr (parse_view) {
+        return Parse{}(input);
+      } else {
+        auto stream = std::ispanstream(std::span<const char>(input.data(), input.size()));
+        return Parse{}(stream);
+      }
+    }
+  });
+}
+
+// Attaches an input generator to an already registered day
+void register_generator(const char* name, generate_function generate);
+
+// Attaches a one-pass form to an already registered day
+void register_stream(const char* name, day_stream stream);
+
+// One-pass form on a `State`, which `Feed` updates with the next bytes of the input, cut anywhere.
+// Each part answers from the final state, `Part2` is nullptr for days without one. All must be captureless lambdas
+template<typename State, typename Feed, typename Part1, typename Part2 = std::nullptr_t>
+void register_stream(const char* name, Feed, Part1, Part2 = nullptr) {
+  auto stream = day_stream{
+    .initial = State{},
+    .feed = [](std::any& state, std::string_view bytes) { Feed{}(std::any_cast<State&>(state), bytes); },
+    .part1 = [](const std::any& state) -> std::string { return Part1{}(std::any_cast<const State&>(state)); },
+  };
+  if constexpr (!std::is_null_pointer_v<Part2>) {
+    stream.part2 = [](const std::any& state) -> std::string { return Part2{}(std::any_cast<const State&>(state)); };
+  }
+  register_stream(name, std::move(stream));
+}
+
+// Line by line state of register_line_stream
+template<typename State>
+struct line_stream_state {
+  State state;
+  // Start of a line whose end did not arrive yet
+  std::string partial;
+};
+
+// Same, with `Line` fed every line of the input as soon as it is complete, without its newline
+template<typename State, typename Line, typename Part1, typename Part2 = std::nullptr_t>
+void register_line_stream(const char* name, Line, Part1, Part2 = nullptr) {
+  using line_state = line_stream_state<State>;
+  auto stream = day_stream{
+    .initial = line_state{},
+    .feed = [](std::any& any, std::string_view bytes) {
+      auto& s = std::any_cast<line_state&>(any);
+      for (size_t eol = bytes.find('\n'); eol != std::string_view::npos; eol = bytes.find('\n')) {
+        if (s.partial.empty()) {
+          Line{}(s.state, bytes.substr(0, eol));
+        } else {
+          s.partial.append(bytes.substr(0, eol));
+          Line{}(s.state, std::string_view(s.partial));
+          s.partial.clear();
+        }
+        bytes.remove_prefix(eol + 1);
+      }
+      s.partial.append(bytes);
+    },
+    // The last line may not end with a newline
+    .finish = [](std::any& any) {
+      auto& s = std::any_cast<line_state&>(any);
+      if (!s.partial.empty()) {
+        Line{}(s.state, std::string_view(s.partial));
+        s.partial.clear();
+      }
+    },
+    .part1 = [](const std::any& state) -> std::string { return Part1{}(std::any_cast<const line_state&>(state).state); },
+  };
+  if constexpr (!std::is_null_pointer_v<Part2>) {
+    stream.part2 = [](const std::any& state) -> std::string { return Part2{}(std::any_cast<const line_state&>(state).state); };
+  }
+  register_stream(name, std::move(stream));
+}
+
 std::span<const day> all_days();
+// Null when no day is registered under `name`
+const day* find_day(std::string_view name);
 
-#define REGISTER_DAY(...) namespace { static const struct auto_register_t { auto_register_t() { register_day(__VA_ARGS__); } } auto_register; }
\ No newline at end of file
+#define REGISTER_DAY(...) namespace { static const struct auto_register_t { auto_register_t() { register_day(__VA_ARGS__); } } auto_register; }
+// Must follow the REGISTER_DAY of the same day in its file
+#define REGISTER_GENERATOR(name, ...) namespace { static const struct auto_register_generator_t { auto_register_generator_t() { register_generator(name, __VA_ARGS__); } } auto_register_generator; }
+// Same, `state` being the type of the state of the one-pass form
+#define REGISTER_STREAM(name, state, ...) namespace { static const struct auto_register_stream_t { auto_register_stream_t() { register_stream<state>(name, __VA_ARGS__); } } auto_register_stream; }
+#define REGISTER_LINE_STREAM(name, state, ...) namespace { static const struct auto_register_stream_t { auto_register_stream_t() { register_line_stream<state>(name, __VA_ARGS__); } } auto_register_stream; }
\ No newline at end of file
@@ -0,0 +1,15 @@
+#include "kernel_bench.hpp"
+#include "days.hpp"
+#include <sstream>
+#include <stdexcept>
+
+std::string generated_input(std::string_view day, size_t scale, uint64_t seed) {
+  for (const ::day& d : all_days()) {
+    if (d.name == day && d.generate) {
+      auto out = std::ostringstream();
+      d.generate(out, scale, seed);
+      return std::move(out).str();
+    }
+  }
+  throw std::logic_error(std::string("no generator for ").append(day));
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Microbenchmarks of the hot kernels of some days live next to their tests, behind AOS_KERNEL_BENCH,
+// which is only defined for the aos_2022_kernels target
+
+#ifdef AOS_KERNEL_BENCH
+#include <benchmark/benchmark.h>
+#include <string>
+#include <string_view>
+
+// Input of `day` written by its generator, `scale` being the benchmark argument
+std::string generated_input(std::string_view day, size_t scale, uint64_t seed = 1);
+#endif
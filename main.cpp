@@ -2,86 +2,553 @@
 //
 
 #include "days.hpp"
+#include "batch.hpp"
+#include "bench.hpp"
+#include "cli.hpp"
+#include "mapped_file.hpp"
+#include "piped_input.hpp"
+#include "result_cache.hpp"
+#include "serve.hpp"
 #include "utils.hpp"
 #include <optional>
-#include <fstream>
 #include <iostream>
-#include <gtest/gtest.h>
+#include <cstring>
+#include <sstream>
 
 struct launch_option {
   struct help {};
   struct run {
+    std::vector<std::string_view> days;
+    size_t workers = std::max(std::thread::hardware_concurrency(), 1u);
+    // Of the parallel loops inside a day, counting the thread running it
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool counters = false;
+    // Answers are looked up and stored in `cache_dir` when set
+    std::optional<cache_mode> cache;
+    std::string_view cache_dir = "result_cache";
+    // Chrome trace of the run is written there when set
+    std::string_view trace_file;
+    // Parts still running after it are stopped at their next checkpoint
+    std::optional<duration_ms> timeout;
+    // Input of the single day read from standard input, as it arrives for days with a one-pass form
+    bool from_stdin = false;
+  };
+  struct batch {
     std::string_view day;
+    std::string_view directory;
+    size_t workers = std::max(std::thread::hardware_concurrency(), 1u);
+    std::optional<duration_ms> timeout;
+  };
+  struct serve {
+    std::string_view socket;
+    size_t workers = std::max(std::thread::hardware_concurrency(), 1u);
   };
-  struct test {
+  struct gen {
     std::string_view day;
+    size_t scale = 1;
+    uint64_t seed = 1;
   };
-  std::variant<help, run, test> mode;
+  std::variant<help, run, batch, serve, gen> mode;
 };
 
+// Milliseconds, at least one
+std::optional<duration_ms> parse_timeout(std::string_view value) {
+  try {
+    auto ms = string_view_to<size_t>(value);
+    return ms > 0 ? std::optional(duration_ms(static_cast<double>(ms))) : std::nullopt;
+  } catch (const std::runtime_error&) {
+    return std::nullopt;
+  }
+}
+
+std::optional<launch_option::run> parse_run_args(std::span<const char*> args) {
+  auto sent = launch_option::run{ parse_day_list(args[0]) };
+  for (size_t i = 1; i < args.size(); ++i) {
+    std::string_view flag = args[i];
+    if (flag == "--counters") {
+      sent.counters = true;
+      continue;
+    }
+    if (flag == "--stdin") {
+      sent.from_stdin = true;
+      continue;
+    }
+    if (i + 1 == args.size()) {
+      return std::nullopt;
+    }
+    std::string_view value = args[++i];
+    if (flag == "--workers") {
+      try {
+        sent.workers = string_view_to<size_t>(value);
+      } catch (const std::runtime_error&) {
+        return std::nullopt;
+      }
+    } else if (flag == "--threads") {
+      try {
+        sent.threads = string_view_to<size_t>(value);
+      } catch (const std::runtime_error&) {
+        return std::nullopt;
+      }
+    } else if (flag == "--cache") {
+      if (value == "use") {
+        sent.cache = cache_mode::use;
+      } else if (value == "refresh") {
+        sent.cache = cache_mode::refresh;
+      } else if (value == "verify") {
+        sent.cache = cache_mode::verify;
+      } else {
+        return std::nullopt;
+      }
+    } else if (flag == "--cache-dir") {
+      sent.cache_dir = value;
+    } else if (flag == "--trace") {
+      sent.trace_file = value;
+    } else if (flag == "--timeout") {
+      sent.timeout = parse_timeout(value);
+      if (!sent.timeout) {
+        return std::nullopt;
+      }
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (sent.workers == 0 || sent.threads == 0) {
+    return std::nullopt;
+  }
+  // Standard input is read once, and cached answers are keyed on a whole input
+  if (sent.from_stdin && (sent.days.size() != 1 || sent.cache)) {
+    return std::nullopt;
+  }
+  return sent;
+}
+
+std::optional<launch_option::batch> parse_batch_args(std::span<const char*> args) {
+  auto sent = launch_option::batch{ args[0], args[1] };
+  for (size_t i = 2; i < args.size(); i += 2) {
+    if (i + 1 == args.size()) {
+      return std::nullopt;
+    }
+    std::string_view flag = args[i];
+    if (flag == "--workers") {
+      try {
+        sent.workers = string_view_to<size_t>(args[i + 1]);
+      } catch (const std::runtime_error&) {
+        return std::nullopt;
+      }
+    } else if (flag == "--timeout") {
+      sent.timeout = parse_timeout(args[i + 1]);
+      if (!sent.timeout) {
+        return std::nullopt;
+      }
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (sent.workers == 0) {
+    return std::nullopt;
+  }
+  return sent;
+}
+
+std::optional<launch_option::serve> parse_serve_args(std::span<const char*> args) {
+  auto sent = launch_option::serve{ args[0] };
+  for (size_t i = 1; i < args.size(); i += 2) {
+    if (i + 1 == args.size() || std::string_view(args[i]) != "--workers") {
+      return std::nullopt;
+    }
+    try {
+      sent.workers = string_view_to<size_t>(args[i + 1]);
+    } catch (const std::runtime_error&) {
+      return std::nullopt;
+    }
+  }
+  if (sent.workers == 0) {
+    return std::nullopt;
+  }
+  return sent;
+}
+
+std::optional<launch_option::gen> parse_gen_args(std::span<const char*> args) {
+  auto sent = launch_option::gen{ args[0] };
+  for (size_t i = 1; i < args.size(); i += 2) {
+    if (i + 1 == args.size()) {
+      return std::nullopt;
+    }
+    std::string_view flag = args[i];
+    try {
+      if (flag == "--scale") {
+        sent.scale = string_view_to<size_t>(args[i + 1]);
+      } else if (flag == "--seed") {
+        sent.seed = string_view_to<uint64_t>(args[i + 1]);
+      } else {
+        return std::nullopt;
+      }
+    } catch (const std::runtime_error&) {
+      return std::nullopt;
+    }
+  }
+  if (sent.scale == 0) {
+    return std::nullopt;
+  }
+  return sent;
+}
+
 launch_option parse_args(int ac, const char** av) {
   launch_option sent = { .mode = launch_option::help{} };
-  if (ac == 3) {
-    if (strcmp(av[1], "run") == 0) {
-      sent.mode = launch_option::run{ av[2] };
+  if (ac >= 3 && strcmp(av[1], "run") == 0) {
+    if (auto run = parse_run_args(std::span(av + 2, ac - 2))) {
+      sent.mode = std::move(*run);
+    }
+  }
+  if (ac >= 4 && strcmp(av[1], "batch") == 0) {
+    if (auto batch = parse_batch_args(std::span(av + 2, ac - 2))) {
+      sent.mode = *batch;
+    }
+  }
+  if (ac >= 3 && strcmp(av[1], "serve") == 0) {
+    if (auto serve = parse_serve_args(std::span(av + 2, ac - 2))) {
+      sent.mode = *serve;
     }
-    else if (strcmp(av[1], "test") == 0) {
-      sent.mode = launch_option::test{ av[2] };
+  }
+  if (ac >= 3 && strcmp(av[1], "gen") == 0) {
+    if (auto gen = parse_gen_args(std::span(av + 2, ac - 2))) {
+      sent.mode = *gen;
     }
   }
   return sent;
 }
 
-const char* exec_name(const char* arg) {
-  size_t offset = std::strlen(arg) - 1;
-  while (offset > 0 && arg[offset - 1] != '/' && arg[offset - 1] != '\\') {
-    --offset;
+struct day_run {
+  std::string output;
+  bool found = true;
+  duration_ms wall{};
+  duration_ms cpu{};
+  // Parts answered from the cache, which are not part of the times
+  size_t cache_hits = 0;
+  // Parts whose answer differs from the cached one, when verifying
+  size_t cache_mismatches = 0;
+  // Parts stopped by the timeout
+  size_t timeouts = 0;
+  // The input is missing or the day threw
+  bool errored = false;
+};
+
+struct run_cache {
+  result_cache cache;
+  cache_mode mode;
+  content_hash build;
+};
+
+void print_stage_counters(std::ostream& out, const stage_metrics& metrics) {
+  if (metrics.counters) {
+    print_counters(out, *metrics.counters);
+  }
+}
+
+// One-pass run of `d` on standard input, fed to it as it arrives. The stream stage and each part are stopped after
+// `timeout`, the stream stage between two chunks only, as a stalled read is not interrupted
+void stream_day(std::ostream& out, day_run& sent, const day& d, perf_counters* counters, std::optional<duration_ms> timeout) {
+  decltype(day_stream::part1) parts[] = { d.stream.part1, d.stream.part2 };
+  const size_t part_count = d.stream.part2 ? 2 : 1;
+  stage_metrics metrics;
+  size_t bytes = 0;
+  std::any state;
+  try {
+    auto stop = std::stop_source();
+    auto timer = timeout ? std::optional<stop_timer>(std::in_place, stop, *timeout) : std::nullopt;
+    state = measure_stage(metrics, counters, [&]() {
+      AOS_TRACE_SCOPE("stream");
+      auto scope = day_stop_scope(stop.get_token());
+      auto input = piped_input();
+      std::any sent = d.stream.initial;
+      for (auto chunk = input.next(); !chunk.empty(); chunk = input.next()) {
+        day_checkpoint([bytes] { return std::to_string(bytes) + " bytes streamed"; });
+        bytes += chunk.size();
+        d.stream.feed(sent, chunk);
+      }
+      if (d.stream.finish) {
+        d.stream.finish(sent);
+      }
+      return sent;
+    });
+  } catch (const day_cancelled& e) {
+    sent.timeouts += part_count;
+    sent.wall += *timeout;
+    out << "Stream: TIMEOUT after " << timeout->count() << "ms, " << e.what() << '\n';
+    return;
+  }
+  sent.wall += metrics.wall;
+  // Includes the time spent waiting for the input
+  out << "Streamed " << bytes << " bytes in " << metrics.wall.count() << "ms\n";
+  print_alloc_stats(out, metrics);
+  print_stage_counters(out, metrics);
+  for (size_t i = 0; i < part_count; ++i) {
+    std::string res;
+    try {
+      auto stop = std::stop_source();
+      auto timer = timeout ? std::optional<stop_timer>(std::in_place, stop, *timeout) : std::nullopt;
+      res = measure_stage(metrics, counters, [&]() {
+        auto scope = day_stop_scope(stop.get_token());
+        return parts[i](state);
+      });
+    } catch (const day_cancelled& e) {
+      ++sent.timeouts;
+      sent.wall += *timeout;
+      out << "Part " << i + 1 << ": TIMEOUT after " << timeout->count() << "ms, " << e.what() << '\n';
+      continue;
+    }
+    sent.wall += metrics.wall;
+    out << "Part " << i + 1 << ": " << res << '\n';
+    out << "  found in " << metrics.wall.count() << "ms\n";
+    print_alloc_stats(out, metrics);
+    print_stage_counters(out, metrics);
   }
-  return &arg[offset];
 }
 
+day_run run_day(std::string_view name, const launch_option::run& run, const run_cache* cache) {
+  day_run sent;
+  std::ostringstream out;
+  out << "Running " << name << ":\n";
+  const day* d = find_day(name);
+  if (!d) {
+    out << "DAY NOT FOUND\n";
+    sent.found = false;
+    sent.output = std::move(out).str();
+    return sent;
+  }
+  AOS_TRACE_SCOPE(d->name);
+  std::optional<mapped_file> file;
+  // Standard input, read whole for days without a one-pass form
+  std::string piped;
+  if (!run.from_stdin) {
+    file = mapped_file::open(input_filename(name));
+  }
+  if (!run.from_stdin && !file) {
+    out << "NO INPUT\n";
+    sent.errored = true;
+  } else if (!d->part1) {
+    out << "NOT IMPLEMENTED\n";
+  } else {
+    // Opened on the thread running the day, as they only count the calling thread
+    std::optional<perf_counters> counters;
+    if (run.counters) {
+      counters.emplace();
+      if (!counters->available()) {
+        out << "Counters unavailable: " << counters->error() << '\n';
+      }
+    }
+    auto cpu_start = thread_cpu_time();
+    try {
+      if (run.from_stdin && d->stream) {
+        stream_day(out, sent, *d, counters ? &*counters : nullptr, run.timeout);
+        sent.cpu = thread_cpu_time() - cpu_start;
+        sent.output = std::move(out).str();
+        return sent;
+      }
+      if (run.from_stdin) {
+        piped_input().read_all(piped);
+      }
+      const std::string_view raw = file ? file->view() : std::string_view(piped);
+      const day_part* parts[] = { &d->part1, &d->part2 };
+      const size_t part_count = d->part2 ? 2 : 1;
+      std::optional<std::string> cached[2];
+      std::optional<cache_key> keys[2];
+      if (cache) {
+        const auto input_hash = hash_bytes(raw);
+        for (size_t i = 0; i < part_count; ++i) {
+          keys[i] = cache_key{ .day = d->name, .part = static_cast<int>(i + 1), .input = input_hash, .build = cache->build };
+          if (cache->mode != cache_mode::refresh) {
+            cached[i] = cache->cache.load(*keys[i]);
+          }
+        }
+      }
+      auto from_cache = [&](size_t i) { return cache && cache->mode == cache_mode::use && cached[i]; };
 
-int main(int ac, const char** av) {
-  match(parse_args(ac, av).mode,
-    [exec = av[0]](launch_option::help) { std::cout << "Usage: " << exec_name(exec) << " run|test <day>\n"; },
-    [](launch_option::run run) {
-      std::cout << "Running " << run.day << ":\n";
-      for (const day& d : all_days()) {
-        if (d.name == run.day) {
-          auto filename = std::string{ "input/" }.append(run.day) + ".txt";
-          auto file = std::ifstream(filename);
-          if (!file) {
-            std::cout << "NO INPUT\n";
-          } else {
-            if (!d.part1) {
-              std::cout << "NOT IMPLEMENTED\n";
-            } else {
-              auto start = std::chrono::steady_clock::now();
-              auto res = d.part1(file);
-              auto end = std::chrono::steady_clock::now();
-              std::cout << "Part 1: " << res << '\n';
-              std::cout << "  found in " << std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(end - start).count() << "ms\n";
-              if (d.part2) {
-                file.clear();
-                file.seekg(0, std::ios_base::beg);
-                start = std::chrono::steady_clock::now();
-                res = d.part2(file);
-                end = std::chrono::steady_clock::now();
-                std::cout << "Part 2: " << res << '\n';
-                std::cout << "  found in " << std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(end - start).count() << "ms\n";
-              }
-            }
+      stage_metrics metrics;
+      perf_counters* c = counters ? &*counters : nullptr;
+      // The model lives in this arena, each part gets its own
+      auto model_arena = day_arena();
+      std::optional<day_input> input;
+      // The parse stage is skipped when every answer is cached
+      if (!from_cache(0) || (part_count == 2 && !from_cache(1))) {
+        input = measure_stage(metrics, c, [&]() {
+          AOS_TRACE_SCOPE("parse");
+          return d->prepare(raw);
+        });
+        if (d->parse) {
+          sent.wall += metrics.wall;
+          out << "Parsed in " << metrics.wall.count() << "ms\n";
+          print_alloc_stats(out, metrics);
+          print_stage_counters(out, metrics);
+        }
+      }
+      for (size_t i = 0; i < part_count; ++i) {
+        if (from_cache(i)) {
+          ++sent.cache_hits;
+          out << "Part " << i + 1 << ": " << *cached[i] << '\n';
+          out << "  from cache\n";
+          continue;
+        }
+        std::string res;
+        try {
+          auto stop = std::stop_source();
+          auto timer = run.timeout ? std::optional<stop_timer>(std::in_place, stop, *run.timeout) : std::nullopt;
+          res = measure_stage(metrics, c, [&]() {
+            AOS_TRACE_SCOPE(i == 0 ? "part 1" : "part 2");
+            auto arena = day_arena();
+            return (*parts[i])(*input, stop.get_token());
+          });
+        } catch (const day_cancelled& e) {
+          ++sent.timeouts;
+          sent.wall += *run.timeout;
+          out << "Part " << i + 1 << ": TIMEOUT after " << run.timeout->count() << "ms, " << e.what() << '\n';
+          continue;
+        }
+        sent.wall += metrics.wall;
+        out << "Part " << i + 1 << ": " << res << '\n';
+        out << "  found in " << metrics.wall.count() << "ms\n";
+        print_alloc_stats(out, metrics);
+        print_stage_counters(out, metrics);
+        if (cache && cache->mode == cache_mode::verify && cached[i]) {
+          if (*cached[i] != res) {
+            ++sent.cache_mismatches;
+            out << "  CACHE MISMATCH, cached: " << *cached[i] << '\n';
           }
-          return;
+        } else if (cache && !cache->cache.store(*keys[i], res)) {
+          out << "  could not be cached\n";
+        }
+      }
+    } catch (const std::exception& e) {
+      out << "ERROR: " << e.what() << '\n';
+      sent.errored = true;
+    }
+    sent.cpu = thread_cpu_time() - cpu_start;
+  }
+  sent.output = std::move(out).str();
+  return sent;
+}
+
+int main(int ac, const char** av) {
+  return match(parse_args(ac, av).mode,
+    [exec = av[0]](launch_option::help) {
+      std::cout << "Usage: " << exec_name(exec) << " run all|<day>,<day>,... [--workers N] [--threads N] [--counters] [--cache use|refresh|verify] [--cache-dir <dir>] [--trace <file.json>] [--timeout <ms>]\n"
+        << "       " << exec_name(exec) << " run <day> --stdin [--threads N] [--counters] [--trace <file.json>] [--timeout <ms>]\n"
+        << "       " << exec_name(exec) << " batch <day> <directory> [--workers N] [--timeout <ms>]\n"
+        << "       " << exec_name(exec) << " serve <socket> [--workers N]\n"
+        << "       " << exec_name(exec) << " gen <day> [--scale N] [--seed S]\n";
+      return 0;
+    },
+    [](const launch_option::run& run) {
+      // Hardware counters are opened per thread, the loops of the days are kept on the thread counting them
+      set_parallelism(run.counters ? 1 : run.threads);
+      if (run.counters && run.threads > 1) {
+        std::cout << "Counters only count the thread running a day, its parallel loops run on it alone\n";
+      }
+#if AOS_TRACE
+      if (!run.trace_file.empty()) {
+        trace::start();
+      }
+#else
+      if (!run.trace_file.empty()) {
+        std::cerr << "Tracing is compiled out, configure with -DAOS_TRACE=ON\n";
+        return 1;
+      }
+#endif
+      std::optional<run_cache> cache;
+      if (run.cache) {
+        if (const auto& build = executable_build_id()) {
+          cache.emplace(result_cache(run.cache_dir), *run.cache, *build);
+        } else {
+          std::cerr << "Cache disabled, the executable could not be read\n";
         }
       }
-      std::cout << "DAY NOT FOUND\n";
+      auto runs = std::vector<day_run>(run.days.size());
+      auto start = std::chrono::steady_clock::now();
+      // One day per chunk, the loops inside a day running on parallel_scheduler()
+      task_scheduler(std::min(run.workers, std::max<size_t>(runs.size(), 1))).run(runs.size(), [&](size_t i) {
+        runs[i] = run_day(run.days[i], run, cache ? &*cache : nullptr);
+      });
+      auto wall = duration_ms(std::chrono::steady_clock::now() - start);
+#if AOS_TRACE
+      if (!run.trace_file.empty()) {
+        trace::stop();
+        auto out = std::ofstream(std::string(run.trace_file));
+        trace::write_json(out);
+        if (!out) {
+          std::cerr << "Could not write the trace to " << run.trace_file << '\n';
+        }
+      }
+#endif
+      duration_ms cpu{};
+      bool all_found = true;
+      size_t cache_hits = 0;
+      size_t cache_mismatches = 0;
+      size_t timeouts = 0;
+      size_t errors = 0;
+      for (const day_run& r : runs) {
+        std::cout << r.output;
+        cpu += r.cpu;
+        all_found = all_found && r.found;
+        cache_hits += r.cache_hits;
+        cache_mismatches += r.cache_mismatches;
+        timeouts += r.timeouts;
+        errors += r.errored ? 1 : 0;
+      }
+      if (runs.size() > 1) {
+        std::cout << "Ran " << runs.size() << " days on " << std::min(run.workers, runs.size()) << " workers"
+          << " in " << wall.count() << "ms wall, " << cpu.count() << "ms cpu"
+          << " (" << (wall.count() > 0 ? cpu / wall : 0) << "x)\n";
+      }
+      if (cache) {
+        std::cout << cache_hits << " parts answered from the cache";
+        if (cache->mode == cache_mode::verify) {
+          std::cout << ", " << cache_mismatches << " differing from it";
+        }
+        std::cout << '\n';
+      }
+      if (timeouts > 0) {
+        std::cout << timeouts << " parts timed out\n";
+      }
+      if (errors > 0) {
+        std::cout << errors << " days errored\n";
+      }
+      return all_found && cache_mismatches == 0 && timeouts == 0 && errors == 0 ? 0 : 1;
+    },
+    [](const launch_option::batch& batch) {
+      const day* d = find_day(batch.day);
+      if (!d) {
+        std::cerr << "DAY NOT FOUND\n";
+        return 1;
+      }
+      if (!d->part1) {
+        std::cerr << "NOT IMPLEMENTED\n";
+        return 1;
+      }
+      try {
+        // Results are the only output on stdout
+        auto summary = run_batch(*d, std::filesystem::path(batch.directory), batch.workers, std::cout, batch.timeout);
+        print_batch_summary(std::cerr, summary);
+        return summary.failures == 0 ? 0 : 1;
+      } catch (const std::filesystem::filesystem_error& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+      }
     },
-    [](launch_option::test test) {
-      ::testing::InitGoogleTest();
-    ::testing::GTEST_FLAG(filter) = std::string{ test.day } + "*";
-      ::testing::GTEST_FLAG(catch_exceptions) = 0;
-      RUN_ALL_TESTS();
+    [](const launch_option::serve& options) {
+      return serve(serve_options{ .socket = std::string(options.socket), .workers = options.workers }, std::cerr);
+    },
+    [](const launch_option::gen& gen) {
+      const day* d = find_day(gen.day);
+      if (!d) {
+        std::cerr << "DAY NOT FOUND\n";
+        return 1;
+      }
+      if (!d->generate) {
+        std::cerr << "NO GENERATOR\n";
+        return 1;
+      }
+      d->generate(std::cout, gen.scale, gen.seed);
+      return 0;
     }
   );
 }
@@ -0,0 +1,120 @@
+#include "mapped_file.hpp"
+#include <utility>
+#include <fstream>
+#include <cstdio>
+#include "tests.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::optional<mapped_file> mapped_file::open(const std::string& filename) {
+  mapped_file sent;
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return std::nullopt;
+  }
+  sent.m_file = file;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    return std::nullopt;
+  }
+  sent.m_size = static_cast<size_t>(size.QuadPart);
+  if (sent.m_size == 0) {
+    return sent;
+  }
+  sent.m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!sent.m_mapping) {
+    return std::nullopt;
+  }
+  sent.m_data = static_cast<const char*>(MapViewOfFile(sent.m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!sent.m_data) {
+    return std::nullopt;
+  }
+#else
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return std::nullopt;
+  }
+  sent.m_size = static_cast<size_t>(st.st_size);
+  if (sent.m_size > 0) {
+    void* data = mmap(nullptr, sent.m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      return std::nullopt;
+    }
+    madvise(data, sent.m_size, MADV_WILLNEED);
+    sent.m_data = static_cast<const char*>(data);
+  }
+  // The mapping stays valid once the descriptor is closed
+  close(fd);
+#endif
+  return sent;
+}
+
+mapped_file::mapped_file(mapped_file&& o) noexcept
+  : m_data(std::exchange(o.m_data, nullptr))
+  , m_size(std::exchange(o.m_size, 0))
+#ifdef _WIN32
+  , m_file(std::exchange(o.m_file, nullptr))
+  , m_mapping(std::exchange(o.m_mapping, nullptr))
+#endif
+{}
+
+mapped_file& mapped_file::operator=(mapped_file&& o) noexcept {
+  // `o` releases the previous mapping when it goes away
+  std::swap(m_data, o.m_data);
+  std::swap(m_size, o.m_size);
+#ifdef _WIN32
+  std::swap(m_file, o.m_file);
+  std::swap(m_mapping, o.m_mapping);
+#endif
+  return *this;
+}
+
+mapped_file::~mapped_file() {
+#ifdef _WIN32
+  if (m_data) {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping) {
+    CloseHandle(m_mapping);
+  }
+  if (m_file) {
+    CloseHandle(m_file);
+  }
+#else
+  if (m_data) {
+    munmap(const_cast<char*>(m_data), m_size);
+  }
+#endif
+}
+
+#ifdef AOS_TESTS
+TEST(mapped_file, view) {
+  const auto filename = std::string("mapped_file_test.txt");
+  {
+    auto out = std::ofstream(filename, std::ios_base::binary);
+    out << "1000\n2000\n";
+  }
+  {
+    auto mapped = mapped_file::open(filename);
+    ASSERT_TRUE(mapped);
+    EXPECT_EQ(mapped->view(), "1000\n2000\n");
+  }
+  std::remove(filename.c_str());
+  EXPECT_FALSE(mapped_file::open(filename));
+}
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file
+class mapped_file {
+public:
+  static std::optional<mapped_file> open(const std::string& filename);
+
+  mapped_file(mapped_file&& o) noexcept;
+  mapped_file& operator=(mapped_file&& o) noexcept;
+  ~mapped_file();
+
+  std::string_view view() const { return { m_data, m_size }; }
+
+private:
+  mapped_file() = default;
+
+  const char* m_data = nullptr;
+  size_t m_size = 0;
+#ifdef _WIN32
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#endif
+};
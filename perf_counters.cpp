@@ -0,0 +1,220 @@
+#include "perf_counters.hpp"
+#include <algorithm>
+#include <ostream>
+#include <utility>
+#include "tests.hpp"
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* to_string(hw_counter c) {
+  switch (c) {
+  case hw_counter::cycles: return "cycles";
+  case hw_counter::instructions: return "instructions";
+  case hw_counter::cache_misses: return "cache-misses";
+  case hw_counter::branch_misses: return "branch-misses";
+  case hw_counter::llc_loads: return "LLC-loads";
+  }
+  std::unreachable();
+}
+
+counter_values& counter_values::operator+=(const counter_values& r) {
+  for (size_t i = 0; i < values.size(); ++i) {
+    if (values[i] && r.values[i]) {
+      *values[i] += *r.values[i];
+    } else {
+      values[i] = std::nullopt;
+    }
+  }
+  return *this;
+}
+
+counter_values& counter_values::operator/=(double d) {
+  for (auto& v : values) {
+    if (v) {
+      *v /= d;
+    }
+  }
+  return *this;
+}
+
+namespace {
+  std::optional<double> ratio(const std::optional<double>& num, const std::optional<double>& den, double scale = 1) {
+    if (!num || !den || *den == 0) {
+      return std::nullopt;
+    }
+    return *num / *den * scale;
+  }
+}
+
+std::optional<double> counter_values::ipc() const {
+  return ratio((*this)[hw_counter::instructions], (*this)[hw_counter::cycles]);
+}
+
+std::optional<double> counter_values::cache_miss_rate() const {
+  return ratio((*this)[hw_counter::cache_misses], (*this)[hw_counter::llc_loads]);
+}
+
+std::optional<double> counter_values::branch_mpki() const {
+  return ratio((*this)[hw_counter::branch_misses], (*this)[hw_counter::instructions], 1000);
+}
+
+void print_counters(std::ostream& out, const counter_values& values) {
+  out << " ";
+  for (hw_counter c : all_hw_counters) {
+    out << ' ' << to_string(c) << ' ';
+    if (values[c]) {
+      out << static_cast<uint64_t>(*values[c]);
+    } else {
+      out << "n/a";
+    }
+  }
+  out << '\n';
+  if (auto ipc = values.ipc()) {
+    out << "  IPC " << *ipc;
+    if (auto rate = values.cache_miss_rate()) {
+      out << ", cache miss rate " << *rate * 100 << '%';
+    }
+    if (auto mpki = values.branch_mpki()) {
+      out << ", branch MPKI " << *mpki;
+    }
+    out << '\n';
+  }
+}
+
+#ifdef __linux__
+
+namespace {
+  perf_event_attr attr_of(hw_counter c) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    switch (c) {
+    case hw_counter::cycles:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case hw_counter::instructions:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case hw_counter::cache_misses:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case hw_counter::branch_misses:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    case hw_counter::llc_loads:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
+      break;
+    }
+    return attr;
+  }
+}
+
+perf_counters::perf_counters() {
+  for (hw_counter c : all_hw_counters) {
+    perf_event_attr attr = attr_of(c);
+    int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, -1, 0));
+    m_fds[static_cast<size_t>(c)] = fd;
+    if (fd < 0 && m_error.empty()) {
+      m_error = std::string("perf_event_open(") + to_string(c) + "): " + std::strerror(errno);
+    }
+  }
+}
+
+perf_counters::~perf_counters() {
+  for (int fd : m_fds) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+bool perf_counters::available() const {
+  return std::ranges::any_of(m_fds, [](int fd) { return fd >= 0; });
+}
+
+void perf_counters::start() {
+  for (int fd : m_fds) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+counter_values perf_counters::stop() {
+  for (int fd : m_fds) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+  counter_values sent;
+  for (size_t i = 0; i < m_fds.size(); ++i) {
+    struct {
+      uint64_t value, time_enabled, time_running;
+    } data;
+    if (m_fds[i] >= 0 && read(m_fds[i], &data, sizeof(data)) == sizeof(data) && data.time_running > 0) {
+      sent.values[i] = static_cast<double>(data.value) * data.time_enabled / data.time_running;
+    }
+  }
+  return sent;
+}
+
+#else
+
+perf_counters::perf_counters()
+  : m_error("hardware counters are only supported on Linux")
+{
+  m_fds.fill(-1);
+}
+
+perf_counters::~perf_counters() = default;
+
+bool perf_counters::available() const { return false; }
+
+void perf_counters::start() {}
+
+counter_values perf_counters::stop() { return {}; }
+
+#endif
+
+#ifdef AOS_TESTS
+TEST(perf_counters, derived) {
+  counter_values v;
+  v[hw_counter::cycles] = 1000;
+  v[hw_counter::instructions] = 2000;
+  v[hw_counter::branch_misses] = 10;
+  EXPECT_EQ(v.ipc(), 2);
+  EXPECT_EQ(v.branch_mpki(), 5);
+  EXPECT_FALSE(v.cache_miss_rate());
+
+  v += v;
+  v /= 2;
+  EXPECT_EQ(v[hw_counter::cycles], 1000);
+  EXPECT_FALSE(v[hw_counter::llc_loads]);
+}
+
+TEST(perf_counters, graceful) {
+  auto counters = perf_counters();
+  counters.start();
+  auto values = counters.stop();
+  if (!counters.available()) {
+    EXPECT_FALSE(counters.error().empty());
+    EXPECT_FALSE(values[hw_counter::cycles]);
+  }
+}
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+
+enum class hw_counter {
+  cycles, instructions, cache_misses, branch_misses, llc_loads
+};
+
+inline constexpr std::array<hw_counter, 5> all_hw_counters{
+  hw_counter::cycles, hw_counter::instructions, hw_counter::cache_misses, hw_counter::branch_misses, hw_counter::llc_loads
+};
+
+const char* to_string(hw_counter c);
+
+// Counts over a measured region, scaled up when the kernel had to multiplex counters.
+// Counters that could not be opened stay empty
+struct counter_values {
+  std::array<std::optional<double>, all_hw_counters.size()> values;
+
+  const std::optional<double>& operator[](hw_counter c) const { return values[static_cast<size_t>(c)]; }
+  std::optional<double>& operator[](hw_counter c) { return values[static_cast<size_t>(c)]; }
+
+  counter_values& operator+=(const counter_values& r);
+  counter_values& operator/=(double d);
+
+  std::optional<double> ipc() const;
+  // cache-misses over LLC loads
+  std::optional<double> cache_miss_rate() const;
+  // branch-misses per thousand instructions
+  std::optional<double> branch_mpki() const;
+};
+
+void print_counters(std::ostream& out, const counter_values& values);
+
+// Hardware performance counters of the calling thread, through perf_event_open on Linux.
+// When the platform or the kernel (perf_event_paranoid, containers...) forbids them,
+// `available()` is false, `error()` says why and `stop()` returns empty values
+class perf_counters {
+public:
+  perf_counters();
+  perf_counters(const perf_counters&) = delete;
+  perf_counters& operator=(const perf_counters&) = delete;
+  ~perf_counters();
+
+  bool available() const;
+  const std::string& error() const { return m_error; }
+
+  void start();
+  counter_values stop();
+
+private:
+  std::array<int, all_hw_counters.size()> m_fds;
+  std::string m_error;
+};
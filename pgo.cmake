@@ -0,0 +1,123 @@
+# Profile-guided and link-time optimized build of aos_cli and aos_bench, reporting the speedup of each stage on every day.
+#   cmake [-DAOS_PGO_BINARY_DIR=<dir>] [-DAOS_PGO_ITERS=N] [-DAOS_PGO_CMAKE_ARGS=<args>] -P pgo.cmake
+# Builds in <dir>, out/build by default:
+#   pgo-baseline  Release
+#   pgo-lto       Release with AOS_LTO
+#   pgo           Release with AOS_LTO, instrumented with AOS_PGO=GENERATE, trained, then rebuilt with AOS_PGO=USE
+# Every stage runs in <dir>/pgo-workload, whose input/ holds the inputs of input/ and generated ones for the days
+# lacking one. The report, the `compare` of each stage against the baseline, is written to <dir>/pgo-report.txt.
+#
+# With -DAOS_PGO_STEP=train, only trains AOS_EXE, an aos_cli, in AOS_PGO_WORKLOAD, writing AOS_PGO_DIR: the aos_pgo_train target
+cmake_minimum_required(VERSION 3.19)
+
+set(AOS_SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}")
+
+# Fills `workload`/input/ for `exe` to run every day. Generated inputs that `exe` cannot solve within a minute,
+# which happens as generators do not bound the search of every day, are left out
+function(aos_prepare_workload exe workload)
+  file(MAKE_DIRECTORY "${workload}/input")
+  file(GLOB inputs "${AOS_SOURCE_DIR}/input/d*.txt")
+  if (inputs)
+    file(COPY ${inputs} DESTINATION "${workload}/input")
+  endif()
+  foreach (i RANGE 1 25)
+    string(LENGTH "${i}" digits)
+    if (digits EQUAL 1)
+      set(i "0${i}")
+    endif()
+    set(input "${workload}/input/d${i}.txt")
+    if (NOT EXISTS "${input}")
+      execute_process(COMMAND "${exe}" gen "d${i}" OUTPUT_FILE "${input}" RESULT_VARIABLE failed ERROR_QUIET)
+      if (NOT failed)
+        execute_process(COMMAND "${exe}" run "d${i}" WORKING_DIRECTORY "${workload}" TIMEOUT 60 RESULT_VARIABLE failed OUTPUT_VARIABLE output ERROR_QUIET)
+        if (NOT failed AND output MATCHES "ERROR")
+          set(failed 1)
+        endif()
+        if (failed)
+          message(STATUS "Leaving d${i} out of the workload, its generated input could not be solved")
+        endif()
+      endif()
+      if (failed)
+        file(REMOVE "${input}")
+      endif()
+    endif()
+  endforeach()
+endfunction()
+
+# The training workload: every day with an input in the prepared `workload`, once. Days without one are not run,
+# as `run` fails on a missing input
+function(aos_train exe workload profile_dir)
+  file(REMOVE_RECURSE "${profile_dir}")
+  file(GLOB inputs RELATIVE "${workload}/input" "${workload}/input/d*.txt")
+  list(SORT inputs)
+  list(TRANSFORM inputs REPLACE "\\.txt$" "")
+  list(JOIN inputs "," days)
+  if (NOT days)
+    message(FATAL_ERROR "No input to train on in ${workload}/input")
+  endif()
+  execute_process(COMMAND "${exe}" run "${days}" WORKING_DIRECTORY "${workload}" OUTPUT_QUIET COMMAND_ERROR_IS_FATAL ANY)
+  # Clang leaves raw profiles to merge
+  file(GLOB raw_profiles "${profile_dir}/*.profraw")
+  if (raw_profiles)
+    find_program(LLVM_PROFDATA llvm-profdata REQUIRED)
+    execute_process(COMMAND "${LLVM_PROFDATA}" merge "-output=${profile_dir}/default.profdata" ${raw_profiles} COMMAND_ERROR_IS_FATAL ANY)
+  endif()
+  message(STATUS "Trained ${exe}, profiles in ${profile_dir}")
+endfunction()
+
+if (AOS_PGO_STEP STREQUAL "train")
+  aos_prepare_workload("${AOS_EXE}" "${AOS_PGO_WORKLOAD}")
+  aos_train("${AOS_EXE}" "${AOS_PGO_WORKLOAD}" "${AOS_PGO_DIR}")
+  return()
+endif()
+
+if (NOT AOS_PGO_BINARY_DIR)
+  set(AOS_PGO_BINARY_DIR "${AOS_SOURCE_DIR}/out/build")
+endif()
+if (NOT AOS_PGO_ITERS)
+  set(AOS_PGO_ITERS 10)
+endif()
+set(workload "${AOS_PGO_BINARY_DIR}/pgo-workload")
+set(baseline_store "${workload}/pgo-baseline.jsonl")
+set(report "${AOS_PGO_BINARY_DIR}/pgo-report.txt")
+
+function(aos_build binary_dir)
+  execute_process(
+    COMMAND "${CMAKE_COMMAND}" -S "${AOS_SOURCE_DIR}" -B "${binary_dir}" -DCMAKE_BUILD_TYPE=Release -DAOS_KERNEL_BENCH=OFF ${AOS_PGO_CMAKE_ARGS} ${ARGN}
+    COMMAND_ERROR_IS_FATAL ANY
+  )
+  execute_process(COMMAND "${CMAKE_COMMAND}" --build "${binary_dir}" --target aos_cli aos_bench COMMAND_ERROR_IS_FATAL ANY)
+endfunction()
+
+# Appends the comparison of the build in `binary_dir` with the baseline to the report
+function(aos_report stage binary_dir)
+  # Exits with 1 on regressions, which are part of the report
+  execute_process(
+    COMMAND "${binary_dir}/aos_bench" compare all --iters ${AOS_PGO_ITERS} --warmup 1 --store "${baseline_store}"
+    WORKING_DIRECTORY "${workload}"
+    OUTPUT_VARIABLE comparison
+  )
+  file(APPEND "${report}" "${stage} against the baseline:\n${comparison}\n")
+  message(STATUS "${stage} against the baseline:\n${comparison}")
+endfunction()
+
+aos_build("${AOS_PGO_BINARY_DIR}/pgo-baseline")
+aos_prepare_workload("${AOS_PGO_BINARY_DIR}/pgo-baseline/aos_cli" "${workload}")
+file(REMOVE "${baseline_store}" "${report}")
+execute_process(
+  COMMAND "${AOS_PGO_BINARY_DIR}/pgo-baseline/aos_bench" compare all --iters ${AOS_PGO_ITERS} --warmup 1 --save --store "${baseline_store}"
+  WORKING_DIRECTORY "${workload}"
+  OUTPUT_QUIET
+)
+
+aos_build("${AOS_PGO_BINARY_DIR}/pgo-lto" -DAOS_LTO=ON -DAOS_PGO=OFF)
+aos_report("LTO" "${AOS_PGO_BINARY_DIR}/pgo-lto")
+
+# The profiles name the objects they come from, so both PGO builds share their directory
+set(pgo_dir "${AOS_PGO_BINARY_DIR}/pgo")
+aos_build("${pgo_dir}" -DAOS_LTO=ON -DAOS_PGO=GENERATE "-DAOS_PGO_DIR=${pgo_dir}/pgo-profile")
+aos_train("${pgo_dir}/aos_cli" "${workload}" "${pgo_dir}/pgo-profile")
+aos_build("${pgo_dir}" -DAOS_PGO=USE)
+aos_report("PGO and LTO" "${pgo_dir}")
+
+message(STATUS "Report written to ${report}")
@@ -0,0 +1,61 @@
+#include "piped_input.hpp"
+#include <cerrno>
+#include <system_error>
+#include "tests.hpp"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+piped_input::piped_input(int fd)
+  : m_fd(fd)
+{}
+
+std::string_view piped_input::next() {
+  for (;;) {
+#ifdef _WIN32
+    auto read = _read(m_fd, m_chunk.data(), static_cast<unsigned>(m_chunk.size()));
+#else
+    auto read = ::read(m_fd, m_chunk.data(), m_chunk.size());
+#endif
+    if (read >= 0) {
+      return { m_chunk.data(), static_cast<size_t>(read) };
+    }
+    if (errno != EINTR) {
+      throw std::system_error(errno, std::generic_category(), "cannot read the input");
+    }
+  }
+}
+
+void piped_input::read_all(std::string& buffer) {
+  for (auto chunk = next(); !chunk.empty(); chunk = next()) {
+    buffer.append(chunk);
+  }
+}
+
+#if defined(AOS_TESTS) && !defined(_WIN32)
+#include <latch>
+#include <thread>
+
+TEST(piped_input, pipe) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  // The first burst is read before the second one is sent
+  auto first_read = std::latch(1);
+  auto writer = std::jthread([fd = fds[1], &first_read]() {
+    EXPECT_EQ(write(fd, "1000\n20", 7), 7);
+    first_read.wait();
+    EXPECT_EQ(write(fd, "00\n", 3), 3);
+    close(fd);
+  });
+  auto input = piped_input(fds[0]);
+  EXPECT_EQ(input.next(), "1000\n20");
+  first_read.count_down();
+  auto rest = std::string("kept ");
+  input.read_all(rest);
+  EXPECT_EQ(rest, "kept 00\n");
+  EXPECT_TRUE(input.next().empty());
+  close(fds[0]);
+}
+#endif
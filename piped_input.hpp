@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Input read from a descriptor as its bytes arrive, such as standard input fed by a pipeline producing it on the fly,
+// which can be neither mapped nor seeked
+class piped_input {
+public:
+  // Standard input by default
+  explicit piped_input(int fd = 0);
+
+  // The next bytes available, waiting for some, empty once the input ended. Valid until the next call.
+  // Throws std::system_error when the descriptor cannot be read
+  std::string_view next();
+
+  // Appends the rest of the input to `buffer`, which callers keep from input to input to reuse its capacity
+  void read_all(std::string& buffer);
+
+private:
+  int m_fd;
+  std::vector<char> m_chunk = std::vector<char>(size_t{ 1 } << 16);
+};
@@ -0,0 +1,170 @@
+#include "result_cache.hpp"
+#include "mapped_file.hpp"
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "tests.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+  // Finalizer of splitmix64
+  uint64_t mix(uint64_t v) {
+    v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9;
+    v = (v ^ (v >> 27)) * 0x94d049bb133111eb;
+    return v ^ (v >> 31);
+  }
+
+  // Suffix of the file an entry is written to before being renamed, unique among the stores of every process
+  std::string tmp_suffix() {
+    static auto stores = std::atomic<uint64_t>{ 0 };
+#ifdef _WIN32
+    const auto pid = GetCurrentProcessId();
+#else
+    const auto pid = getpid();
+#endif
+    return ".tmp" + std::to_string(pid) + '-' + std::to_string(stores++);
+  }
+
+  std::optional<std::string> executable_path() {
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD size = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    if (size == 0 || size == MAX_PATH) {
+      return std::nullopt;
+    }
+    return std::string(path, size);
+#else
+    std::error_code ec;
+    auto path = std::filesystem::read_symlink("/proc/self/exe", ec);
+    if (ec) {
+      return std::nullopt;
+    }
+    return path.string();
+#endif
+  }
+}
+
+std::string content_hash::to_string() const {
+  static constexpr char digits[] = "0123456789abcdef";
+  auto sent = std::string(32, '0');
+  for (size_t i = 0; i < 16; ++i) {
+    sent[15 - i] = digits[(high >> (4 * i)) & 0xf];
+    sent[31 - i] = digits[(low >> (4 * i)) & 0xf];
+  }
+  return sent;
+}
+
+// Two lanes eating 8 bytes at a time, with different rotations and multipliers
+content_hash hash_bytes(std::string_view bytes) {
+  uint64_t a = 0x9e3779b97f4a7c15 ^ bytes.size();
+  uint64_t b = 0xc2b2ae3d27d4eb4f + bytes.size();
+  size_t i = 0;
+  for (; i + 8 <= bytes.size(); i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes.data() + i, 8);
+    a = std::rotl(a ^ word, 29) * 0xbf58476d1ce4e5b9;
+    b = std::rotl(b + word, 31) * 0x94d049bb133111eb;
+  }
+  uint64_t tail = 0;
+  if (i < bytes.size()) {
+    std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
+  }
+  a = mix(a ^ tail);
+  b = mix(b + tail + a);
+  return content_hash{ .high = mix(a ^ b), .low = b };
+}
+
+const std::optional<content_hash>& executable_build_id() {
+  static const std::optional<content_hash> sent = []() -> std::optional<content_hash> {
+    auto path = executable_path();
+    if (!path) {
+      return std::nullopt;
+    }
+    auto file = mapped_file::open(*path);
+    if (!file) {
+      return std::nullopt;
+    }
+    return hash_bytes(file->view());
+  }();
+  return sent;
+}
+
+result_cache::result_cache(std::filesystem::path directory)
+  : m_directory(std::move(directory))
+{}
+
+std::optional<std::string> result_cache::load(const cache_key& key) const {
+  auto file = std::ifstream(path_of(key), std::ios_base::binary);
+  if (!file) {
+    return std::nullopt;
+  }
+  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+bool result_cache::store(const cache_key& key, std::string_view result) const {
+  std::error_code ec;
+  std::filesystem::create_directories(m_directory, ec);
+  auto path = path_of(key);
+  auto tmp = path;
+  tmp += tmp_suffix();
+  {
+    auto file = std::ofstream(tmp, std::ios_base::binary | std::ios_base::trunc);
+    if (!file.write(result.data(), result.size()) || !file.flush()) {
+      file.close();
+      std::filesystem::remove(tmp, ec);
+      return false;
+    }
+  }
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    std::error_code ignored;
+    std::filesystem::remove(tmp, ignored);
+    return false;
+  }
+  return true;
+}
+
+std::filesystem::path result_cache::path_of(const cache_key& key) const {
+  return m_directory / (std::string(key.day) + '-' + std::to_string(key.part) + '-' + key.input.to_string() + '-' + key.build.to_string());
+}
+
+#ifdef AOS_TESTS
+TEST(result_cache, hash) {
+  EXPECT_EQ(hash_bytes("some input\n"), hash_bytes(std::string("some input\n")));
+  EXPECT_NE(hash_bytes("some input\n"), hash_bytes("some input"));
+  EXPECT_NE(hash_bytes("0123456789abcdef"), hash_bytes("0123456789abcdeF"));
+  EXPECT_NE(hash_bytes(""), hash_bytes(std::string_view("\0", 1)));
+  EXPECT_EQ((content_hash{ .high = 0xab, .low = 1 }).to_string(), "00000000000000ab0000000000000001");
+}
+
+TEST(result_cache, store) {
+  auto directory = std::filesystem::temp_directory_path() / "aos_result_cache_test";
+  std::filesystem::remove_all(directory);
+  auto cache = result_cache(directory);
+  auto key = cache_key{ .day = "d10", .part = 2, .input = hash_bytes("input"), .build = hash_bytes("build") };
+  EXPECT_FALSE(cache.load(key));
+  EXPECT_TRUE(cache.store(key, "\n##..\n"));
+  EXPECT_EQ(cache.load(key), "\n##..\n");
+  EXPECT_FALSE(cache.load(cache_key{ .day = "d10", .part = 1, .input = key.input, .build = key.build }));
+  EXPECT_FALSE(cache.load(cache_key{ .day = "d10", .part = 2, .input = key.input, .build = hash_bytes("other build") }));
+  EXPECT_TRUE(cache.store(key, "overwritten"));
+  EXPECT_EQ(cache.load(key), "overwritten");
+
+  // An entry that cannot be replaced leaves no temporary file behind
+  const auto entry = std::filesystem::directory_iterator(directory)->path();
+  std::filesystem::remove(entry);
+  std::filesystem::create_directories(entry / "blocking");
+  EXPECT_FALSE(cache.store(key, "blocked"));
+  EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()), 1);
+  std::filesystem::remove_all(directory);
+}
+#endif
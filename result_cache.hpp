@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// 128 bits hash of some bytes, to tell identical inputs and builds apart. Not cryptographic
+struct content_hash {
+  uint64_t high = 0;
+  uint64_t low = 0;
+
+  auto operator<=>(const content_hash&) const = default;
+
+  std::string to_string() const;
+};
+
+content_hash hash_bytes(std::string_view bytes);
+
+// Hash of the running executable's file, computed on first use, empty when it cannot be read
+const std::optional<content_hash>& executable_build_id();
+
+struct cache_key {
+  std::string_view day;
+  int part;
+  content_hash input;
+  content_hash build;
+};
+
+enum class cache_mode {
+  // Answers found in the cache are not computed, the others are stored
+  use,
+  // Everything is computed and stored, overwriting what was cached
+  refresh,
+  // Everything is computed and checked against what was cached
+  verify,
+};
+
+// Answers of parts stored on disk, a file per key in `directory`
+class result_cache {
+public:
+  explicit result_cache(std::filesystem::path directory);
+
+  std::optional<std::string> load(const cache_key& key) const;
+  // Written aside then renamed, so that concurrent runs never read a partial answer
+  bool store(const cache_key& key, std::string_view result) const;
+
+private:
+  std::filesystem::path path_of(const cache_key& key) const;
+
+  std::filesystem::path m_directory;
+};
@@ -0,0 +1,462 @@
+#include "serve.hpp"
+#include "days.hpp"
+#include "mapped_file.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include "tests.hpp"
+#ifdef AOS_TESTS
+#include <filesystem>
+#include <sstream>
+#endif
+#ifndef _WIN32
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+  // Longest header line accepted, and largest input sent inline
+  constexpr size_t max_header = 4096;
+  constexpr size_t max_input = size_t{ 1 } << 30;
+
+  void append_error(std::string& out, std::string_view message) {
+    out += "error ";
+    for (char c : message) {
+      out += c == '\n' ? ' ' : c;
+    }
+    out += '\n';
+  }
+
+#ifndef _WIN32
+  // A client, whose requests are cut by the poll loop of `serve` as their bytes arrive and answered by the workers.
+  // Its socket is closed once the poll loop dropped it and every request it sent is answered
+  struct connection {
+    explicit connection(int fd)
+      : fd(fd)
+    {}
+    connection(const connection&) = delete;
+    connection& operator=(const connection&) = delete;
+    ~connection() {
+      ::close(fd);
+    }
+
+    const int fd;
+    // Only used by the poll loop: bytes received and not cut into requests yet start at `start`
+    std::string buffer;
+    size_t start = 0;
+    size_t requests = 0;
+
+    // Answers are written in the order of the requests, those solved early waiting in `solved`
+    std::mutex mutex;
+    size_t written = 0;
+    std::map<size_t, std::string> solved;
+  };
+
+  struct job {
+    std::shared_ptr<connection> from;
+    size_t index;
+    // Empty when the header was invalid, which ends the connection
+    std::optional<solve_request> request;
+    std::string input;
+  };
+
+  bool write_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+      // No SIGPIPE when the client went away
+      auto written = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      data.remove_prefix(static_cast<size_t>(written));
+    }
+    return true;
+  }
+
+  // Appends what `c` has received, false once it ended or failed
+  bool receive(connection& c) {
+    // Drops what was consumed before growing the buffer
+    c.buffer.erase(0, c.start);
+    c.start = 0;
+    size_t size = c.buffer.size();
+    c.buffer.resize(size + 64 * 1024);
+    ssize_t received;
+    do {
+      received = ::recv(c.fd, c.buffer.data() + size, c.buffer.size() - size, MSG_DONTWAIT);
+    } while (received < 0 && errno == EINTR);
+    c.buffer.resize(size + static_cast<size_t>(std::max<ssize_t>(received, 0)));
+    return received > 0 || (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+  }
+
+  // Passes every whole request received by `c` to `queue`, false once `c` must not be read any more
+  template<typename Queue>
+  bool cut_requests(const std::shared_ptr<connection>& c, Queue&& queue) {
+    for (;;) {
+      const auto pending = std::string_view(c->buffer).substr(c->start);
+      const size_t eol = pending.find('\n');
+      if (eol == std::string_view::npos) {
+        return pending.size() <= max_header;
+      }
+      auto request = parse_request_header(pending.substr(0, eol));
+      std::string input;
+      if (request && !request->path) {
+        if (pending.size() - eol - 1 < request->size) {
+          return true;
+        }
+        input = std::string(pending.substr(eol + 1, request->size));
+        c->start += request->size;
+      }
+      c->start += eol + 1;
+      const bool valid = request.has_value();
+      queue(job{ .from = c, .index = c->requests++, .request = std::move(request), .input = std::move(input) });
+      if (!valid) {
+        return false;
+      }
+    }
+  }
+
+  std::string answer(const job& j) {
+    std::string sent;
+    if (!j.request) {
+      append_error(sent, "invalid request");
+    } else if (j.request->path) {
+      if (auto file = mapped_file::open(*j.request->path)) {
+        answer_request(*j.request, file->view(), sent);
+      } else {
+        append_error(sent, "cannot open " + *j.request->path);
+      }
+    } else {
+      answer_request(*j.request, j.input, sent);
+    }
+    return sent;
+  }
+
+  // Writes the answers of `c` that are next in line, a failed write leaving the poll loop to notice the connection ended
+  void respond(connection& c, size_t index, std::string response) {
+    auto lock = std::lock_guard(c.mutex);
+    c.solved.emplace(index, std::move(response));
+    for (auto next = c.solved.begin(); next != c.solved.end() && next->first == c.written; next = c.solved.erase(next)) {
+      write_all(c.fd, next->second);
+      ++c.written;
+    }
+  }
+
+  // Write end of the pipe waking the poll loop of `serve` on SIGINT and SIGTERM
+  std::atomic<int> g_stop_pipe{ -1 };
+
+  void on_stop_signal(int) {
+    const int saved_errno = errno;
+    if (const int fd = g_stop_pipe.load(); fd >= 0) {
+      const char byte = 0;
+      [[maybe_unused]] auto written = ::write(fd, &byte, 1);
+    }
+    errno = saved_errno;
+  }
+#endif
+}
+
+std::optional<solve_request> parse_request_header(std::string_view line) {
+  auto first_space = line.find(' ');
+  auto second_space = line.find(' ', first_space + 1);
+  if (first_space == std::string_view::npos || second_space == std::string_view::npos) {
+    return std::nullopt;
+  }
+  auto sent = solve_request{ .day = std::string(line.substr(0, first_space)) };
+  auto part = line.substr(first_space + 1, second_space - first_space - 1);
+  if (part == "1" || part == "2") {
+    sent.part = part[0] - '0';
+  } else if (part != "*") {
+    return std::nullopt;
+  }
+  auto input = line.substr(second_space + 1);
+  if (input.starts_with('@')) {
+    if (input.size() == 1) {
+      return std::nullopt;
+    }
+    sent.path = std::string(input.substr(1));
+    return sent;
+  }
+  try {
+    sent.size = string_view_to<size_t>(input);
+  } catch (const std::runtime_error&) {
+    return std::nullopt;
+  }
+  if (sent.size > max_input || std::to_string(sent.size) != input) {
+    return std::nullopt;
+  }
+  return sent;
+}
+
+void answer_request(const solve_request& request, std::string_view input, std::string& out) {
+  const day* d = find_day(request.day);
+  if (!d || !d->part1) {
+    append_error(out, "unknown day " + request.day);
+    return;
+  }
+  if (request.part == 2 && !d->part2) {
+    append_error(out, "no part 2 for " + request.day);
+    return;
+  }
+  std::string response;
+  try {
+    auto model_arena = day_arena();
+    const day_input model = d->prepare(input);
+    const day_part* parts[] = { &d->part1, &d->part2 };
+    for (int part = 1; part <= 2; ++part) {
+      if ((request.part != 0 && request.part != part) || !*parts[part - 1]) {
+        continue;
+      }
+      auto start = std::chrono::steady_clock::now();
+      auto result = [&]() { auto arena = day_arena(); return (*parts[part - 1])(model); }();
+      auto wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+      char ms[32];
+      auto end = std::to_chars(ms, ms + sizeof(ms), wall.count()).ptr;
+      response.append("part ").append(std::to_string(part)).append(" ").append(ms, end)
+        .append(" ").append(std::to_string(result.size())).append("\n").append(result);
+    }
+  } catch (const std::exception& e) {
+    append_error(out, e.what());
+    return;
+  }
+  out.append(response).append("done\n");
+}
+
+int serve(const serve_options& options, std::ostream& log) {
+#ifdef _WIN32
+  (void)options;
+  log << "serve is only available with Unix domain sockets\n";
+  return 1;
+#else
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (options.socket.size() >= sizeof(address.sun_path)) {
+    log << "socket path too long\n";
+    return 1;
+  }
+  std::memcpy(address.sun_path, options.socket.c_str(), options.socket.size() + 1);
+  int stop_pipe[2];
+  if (::pipe2(stop_pipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+    log << "pipe: " << std::strerror(errno) << '\n';
+    return 1;
+  }
+  int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listener < 0) {
+    log << "socket: " << std::strerror(errno) << '\n';
+    ::close(stop_pipe[0]);
+    ::close(stop_pipe[1]);
+    return 1;
+  }
+  ::unlink(options.socket.c_str());
+  if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listener, SOMAXCONN) < 0) {
+    log << "cannot listen on " << options.socket << ": " << std::strerror(errno) << '\n';
+    ::close(listener);
+    ::close(stop_pipe[0]);
+    ::close(stop_pipe[1]);
+    return 1;
+  }
+  g_stop_pipe = stop_pipe[1];
+  struct sigaction on_stop{};
+  on_stop.sa_handler = on_stop_signal;
+  sigemptyset(&on_stop.sa_mask);
+  struct sigaction previous_int{}, previous_term{};
+  ::sigaction(SIGINT, &on_stop, &previous_int);
+  ::sigaction(SIGTERM, &on_stop, &previous_term);
+  log << "Serving on " << options.socket << " with " << options.workers << " workers\n";
+
+  // Whole requests waiting for a worker, answered even once stopping
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<job> jobs;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < options.workers; ++i) {
+    workers.emplace_back([&]() {
+      for (;;) {
+        auto lock = std::unique_lock(mutex);
+        ready.wait(lock, [&]() { return !jobs.empty() || stopping; });
+        if (jobs.empty()) {
+          return;
+        }
+        job j = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+        respond(*j.from, j.index, answer(j));
+      }
+    });
+  }
+  auto queue = [&](job j) {
+    {
+      auto lock = std::lock_guard(mutex);
+      jobs.push_back(std::move(j));
+    }
+    ready.notify_one();
+  };
+
+  // Connections still read, a worker only holding one while it answers one of its requests
+  std::vector<std::shared_ptr<connection>> connections;
+  std::vector<pollfd> polled;
+  // The listener is left out of the poll for a while after a persistent error, such as running out of descriptors,
+  // doubled while it lasts
+  auto backoff = std::chrono::milliseconds(0);
+  auto listen_at = std::chrono::steady_clock::now();
+  int sent = 0;
+  for (bool stop = false; !stop;) {
+    const auto now = std::chrono::steady_clock::now();
+    const bool listening = now >= listen_at;
+    polled.clear();
+    polled.push_back(pollfd{ .fd = stop_pipe[0], .events = POLLIN });
+    // Negative descriptors are ignored
+    polled.push_back(pollfd{ .fd = listening ? listener : -1, .events = POLLIN });
+    for (const auto& c : connections) {
+      polled.push_back(pollfd{ .fd = c->fd, .events = POLLIN });
+    }
+    const auto timeout = listening ? -1 : static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(listen_at - now).count());
+    if (::poll(polled.data(), polled.size(), timeout) < 0) {
+      if (errno != EINTR) {
+        log << "poll: " << std::strerror(errno) << '\n';
+        sent = 1;
+        break;
+      }
+      continue;
+    }
+    stop = polled[0].revents != 0;
+    if (polled[1].revents != 0) {
+      int fd = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd >= 0) {
+        connections.push_back(std::make_shared<connection>(fd));
+        backoff = std::chrono::milliseconds(0);
+      } else if (errno != EINTR && errno != ECONNABORTED && errno != EAGAIN && errno != EWOULDBLOCK) {
+        log << "accept: " << std::strerror(errno) << '\n';
+        backoff = std::clamp(backoff * 2, std::chrono::milliseconds(10), std::chrono::milliseconds(1000));
+        listen_at = now + backoff;
+      }
+    }
+    // From the back, so that the connection swapped into a dropped one's place was already handled
+    for (size_t i = connections.size(); i-- > 0;) {
+      if (polled[i + 2].revents != 0 && (!receive(*connections[i]) || !cut_requests(connections[i], queue))) {
+        connections[i] = std::move(connections.back());
+        connections.pop_back();
+      }
+    }
+  }
+
+  g_stop_pipe = -1;
+  ::sigaction(SIGINT, &previous_int, nullptr);
+  ::sigaction(SIGTERM, &previous_term, nullptr);
+  ::close(listener);
+  ::unlink(options.socket.c_str());
+  connections.clear();
+  {
+    auto lock = std::lock_guard(mutex);
+    stopping = true;
+  }
+  ready.notify_all();
+  for (std::thread& w : workers) {
+    w.join();
+  }
+  ::close(stop_pipe[0]);
+  ::close(stop_pipe[1]);
+  log << "Stopped serving on " << options.socket << '\n';
+  return sent;
+#endif
+}
+
+#ifdef AOS_TESTS
+TEST(serve, parse_request_header) {
+  auto inline_input = parse_request_header("d01 * 42");
+  ASSERT_TRUE(inline_input);
+  EXPECT_EQ(inline_input->day, "d01");
+  EXPECT_EQ(inline_input->part, 0);
+  EXPECT_EQ(inline_input->size, 42);
+  EXPECT_FALSE(inline_input->path);
+
+  auto file_input = parse_request_header("d16 2 @input/d16.txt");
+  ASSERT_TRUE(file_input);
+  EXPECT_EQ(file_input->part, 2);
+  EXPECT_EQ(file_input->path, "input/d16.txt");
+
+  EXPECT_FALSE(parse_request_header("d01 3 42"));
+  EXPECT_FALSE(parse_request_header("d01 1"));
+  EXPECT_FALSE(parse_request_header("d01 1 -1"));
+  EXPECT_FALSE(parse_request_header("d01 1 12x"));
+  EXPECT_FALSE(parse_request_header("d01 1 @"));
+}
+
+TEST(serve, answer_request) {
+  auto input = std::string_view("1000\n2000\n3000\n\n4000\n\n5000\n6000\n\n7000\n8000\n9000\n\n10000\n");
+  std::string both;
+  answer_request(solve_request{ .day = "d01", .part = 0 }, input, both);
+  ASSERT_TRUE(both.starts_with("part 1 ")) << both;
+  EXPECT_NE(both.find(" 5\n24000part 2 "), std::string::npos) << both;
+  EXPECT_TRUE(both.ends_with(" 5\n45000done\n")) << both;
+
+  std::string second;
+  answer_request(solve_request{ .day = "d01", .part = 2 }, input, second);
+  EXPECT_TRUE(second.starts_with("part 2 ")) << second;
+  EXPECT_TRUE(second.ends_with(" 5\n45000done\n")) << second;
+
+  std::string unknown;
+  answer_request(solve_request{ .day = "d99", .part = 1 }, input, unknown);
+  EXPECT_EQ(unknown, "error unknown day d99\n");
+}
+
+#ifndef _WIN32
+TEST(serve, connections) {
+  const auto path = (std::filesystem::temp_directory_path() / ("aos_serve_test_" + std::to_string(::getpid()))).string();
+  auto log = std::ostringstream();
+  auto server = std::thread([&]() { EXPECT_EQ(serve(serve_options{ .socket = path, .workers = 1 }, log), 0); });
+  auto connect_client = [&]() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    for (;;) {
+      int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+      if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+        return fd;
+      }
+      ::close(fd);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  };
+
+  // Does not hold the single worker
+  const int idle = connect_client();
+  const int client = connect_client();
+  const std::string request = "d01 1 7\n1\n2\n\n4\n";
+  ASSERT_TRUE(write_all(client, request + request + "d01 1 x\n"));
+  std::string received;
+  char buffer[256];
+  for (ssize_t size; (size = ::recv(client, buffer, sizeof(buffer), 0)) > 0;) {
+    received.append(buffer, static_cast<size_t>(size));
+  }
+  EXPECT_TRUE(received.starts_with("part 1 ")) << received;
+  EXPECT_NE(received.find(" 1\n4done\npart 1 "), std::string::npos) << received;
+  EXPECT_TRUE(received.ends_with(" 1\n4done\nerror invalid request\n")) << received;
+  ::close(client);
+  ::close(idle);
+
+  std::raise(SIGTERM);
+  server.join();
+  EXPECT_FALSE(std::filesystem::exists(path));
+}
+#endif
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Protocol of `serve`. A connection carries any number of requests, one after the other:
+//   request:  "<day> <part> <size>\n" followed by <size> bytes of input,
+//             or "<day> <part> @<path>\n" to have the server read the input from <path>.
+//             <part> is 1, 2, or * for every part of the day sharing a single parse stage
+//   response: "part <part> <ms> <size>\n" followed by the <size> bytes of the answer for every part solved,
+//             then "done\n". Or "error <message>\n" alone when the request could not be solved
+struct solve_request {
+  std::string day;
+  // 0 for every part
+  int part = 0;
+  // Size of the input following the header, when not read from `path`
+  size_t size = 0;
+  std::optional<std::string> path;
+};
+
+std::optional<solve_request> parse_request_header(std::string_view line);
+
+// Solves `request` on `input` and appends the response to `out`
+void answer_request(const solve_request& request, std::string_view input, std::string& out);
+
+struct serve_options {
+  std::string socket;
+  size_t workers = 1;
+};
+
+// Listens on a Unix domain socket, replacing any file at its path. A single thread polls every connection and hands
+// each request, once whole, to one of `workers` threads, so that idle connections hold no worker and the requests of a
+// connection are solved concurrently, answered in their order. Stops on SIGINT or SIGTERM, once the requests received
+// are answered, removing the socket file, and returns 0. Returns 1 when it cannot listen, after telling why to `log`
+int serve(const serve_options& options, std::ostream& log);
@@ -0,0 +1,8 @@
+#pragma once
+
+// Tests live next to the code they test, behind AOS_TESTS,
+// which is only defined for the aos_tests target
+
+#ifdef AOS_TESTS
+#include <gtest/gtest.h>
+#endif
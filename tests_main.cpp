@@ -0,0 +1,12 @@
+#include <gtest/gtest.h>
+#include <string>
+
+// aos_tests [<prefix>] runs the tests whose name starts with <prefix>, every test without it. gtest flags are accepted too
+int main(int ac, char** av) {
+  ::testing::InitGoogleTest(&ac, av);
+  if (ac == 2) {
+    ::testing::GTEST_FLAG(filter) = std::string{ av[1] } + "*";
+  }
+  ::testing::GTEST_FLAG(catch_exceptions) = 0;
+  return RUN_ALL_TESTS();
+}
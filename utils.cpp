@@ -0,0 +1,740 @@
+#include "utils.hpp"
+#include "kernel_bench.hpp"
+#include "tests.hpp"
+#include <string>
+#include <vector>
+#if AOS_TRACE
+#include <memory>
+#include <mutex>
+#include <ostream>
+#endif
+
+#if AOS_TRACE
+namespace trace {
+  namespace {
+    struct event_t {
+      const char* name;
+      int64_t begin_ns;
+      int64_t end_ns;
+    };
+
+    // Latest events of one thread: once full, each event overwrites the oldest one
+    struct ring_t {
+      static constexpr size_t capacity = size_t{ 1 } << 16;
+
+      explicit ring_t(size_t tid) : tid(tid) {}
+
+      size_t tid;
+      std::unique_ptr<event_t[]> events = std::make_unique<event_t[]>(capacity);
+      // Every event since `start`, the ring holds the last `capacity` of them
+      std::atomic<uint64_t> recorded{ 0 };
+    };
+
+    // Rings are owned here rather than by their threads, so that the events of finished workers are still dumped
+    std::mutex g_rings_mutex;
+    std::vector<std::unique_ptr<ring_t>> g_rings;
+    int64_t g_start_ns = 0;
+    thread_local ring_t* t_ring = nullptr;
+
+    ring_t& local_ring() {
+      if (!t_ring) {
+        auto lock = std::lock_guard(g_rings_mutex);
+        t_ring = g_rings.emplace_back(std::make_unique<ring_t>(g_rings.size() + 1)).get();
+      }
+      return *t_ring;
+    }
+
+    void write_json_string(std::ostream& out, std::string_view s) {
+      out << '"';
+      for (char c : s) {
+        if (c == '"' || c == '\\') {
+          out << '\\';
+        }
+        out << c;
+      }
+      out << '"';
+    }
+
+    // Chrome wants microseconds, kept to the nanosecond without going through the 6 digits of a double
+    void write_us(std::ostream& out, int64_t ns) {
+      ns = std::max<int64_t>(ns, 0);
+      const int64_t fraction = ns % 1000;
+      out << ns / 1000 << '.' << fraction / 100 << fraction / 10 % 10 << fraction % 10;
+    }
+  }
+
+  void record(const char* name, int64_t begin_ns, int64_t end_ns) {
+    ring_t& ring = local_ring();
+    uint64_t recorded = ring.recorded.load(std::memory_order_relaxed);
+    ring.events[recorded % ring_t::capacity] = event_t{ name, begin_ns, end_ns };
+    ring.recorded.store(recorded + 1, std::memory_order_release);
+  }
+
+  void start() {
+    auto lock = std::lock_guard(g_rings_mutex);
+    for (auto& ring : g_rings) {
+      ring->recorded.store(0, std::memory_order_relaxed);
+    }
+    g_start_ns = now_ns();
+    g_enabled.store(true, std::memory_order_relaxed);
+  }
+
+  void stop() {
+    g_enabled.store(false, std::memory_order_relaxed);
+  }
+
+  void write_json(std::ostream& out) {
+    auto lock = std::lock_guard(g_rings_mutex);
+    uint64_t dropped = 0;
+    const char* sep = "\n";
+    out << "{\"traceEvents\":[";
+    for (const auto& ring : g_rings) {
+      const uint64_t recorded = ring->recorded.load(std::memory_order_acquire);
+      if (recorded == 0) {
+        continue;
+      }
+      out << sep << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid
+        << ",\"args\":{\"name\":\"thread " << ring->tid << "\"}}";
+      sep = ",\n";
+      const uint64_t first = recorded > ring_t::capacity ? recorded - ring_t::capacity : 0;
+      dropped += first;
+      for (uint64_t i = first; i < recorded; ++i) {
+        const event_t& e = ring->events[i % ring_t::capacity];
+        out << sep << "{\"name\":";
+        write_json_string(out, e.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid
+          << ",\"ts\":";
+        write_us(out, e.begin_ns - g_start_ns);
+        out << ",\"dur\":";
+        write_us(out, e.end_ns - e.begin_ns);
+        out << '}';
+      }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+  }
+}
+#endif
+
+namespace {
+  // Scheduler whose loop the calling thread takes part in, loops started from it running inline
+  thread_local const task_scheduler* t_scheduler = nullptr;
+
+  constexpr uint64_t pack_range(uint64_t begin, uint64_t end) {
+    return (begin << 32) | end;
+  }
+
+  constinit usage_hooks g_usage_hooks;
+}
+
+void set_usage_hooks(usage_hooks hooks)
+{
+  g_usage_hooks = hooks;
+}
+
+namespace {
+}
+
+task_scheduler::task_scheduler(size_t threads)
+{
+  set_threads(threads);
+}
+
+task_scheduler::~task_scheduler()
+{
+  for (std::jthread& w : m_workers) {
+    w.request_stop();
+  }
+}
+
+void task_scheduler::set_threads(size_t threads)
+{
+  if (t_scheduler == this) {
+    throw std::logic_error("Thread count changed from a loop of the scheduler");
+  }
+  auto running = std::lock_guard(m_running);
+  // Joined as they are destroyed
+  m_workers.clear();
+  m_queues = std::make_unique<queue_t[]>(std::max<size_t>(threads, 1));
+  const uint64_t generation = m_generation;
+  for (size_t i = 1; i < threads; ++i) {
+    m_workers.emplace_back([this, i, generation](std::stop_token stop) { work(stop, i, generation); });
+  }
+}
+
+void task_scheduler::run_erased(size_t chunks, void (*body)(void*, size_t), void* context)
+{
+  assert(chunks < (uint64_t{ 1 } << 32));
+  if (chunks <= 1 || m_workers.empty() || t_scheduler == this || !m_running.try_lock()) {
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+      body(context, chunk);
+    }
+    return;
+  }
+  auto running = std::lock_guard(m_running, std::adopt_lock);
+  m_body = body;
+  m_context = context;
+  m_failed = false;
+  m_error = nullptr;
+  const size_t count = threads();
+  for (size_t t = 0; t < count; ++t) {
+    m_queues[t].range = pack_range(chunks * t / count, chunks * (t + 1) / count);
+  }
+  {
+    auto lock = std::lock_guard(m_mutex);
+    m_busy = m_workers.size();
+    ++m_generation;
+  }
+  m_wake.notify_all();
+
+  // Restored for loops run from a chunk of another scheduler
+  const task_scheduler* outer = std::exchange(t_scheduler, this);
+  drain(0);
+  t_scheduler = outer;
+
+  auto lock = std::unique_lock(m_mutex);
+  m_done.wait(lock, [this] { return m_busy == 0; });
+  if (g_usage_hooks.add) {
+    g_usage_hooks.add(std::exchange(m_usage, thread_usage{}));
+  }
+  if (m_error) {
+    std::rethrow_exception(std::exchange(m_error, nullptr));
+  }
+}
+
+void task_scheduler::work(std::stop_token stop, size_t self, uint64_t seen)
+{
+  t_scheduler = this;
+  while (true) {
+    {
+      auto lock = std::unique_lock(m_mutex);
+      if (!m_wake.wait(lock, stop, [&] { return m_generation != seen; })) {
+        return;
+      }
+      seen = m_generation;
+    }
+    const thread_usage before = g_usage_hooks.read ? g_usage_hooks.read() : thread_usage{};
+    drain(self);
+    const thread_usage after = g_usage_hooks.read ? g_usage_hooks.read() : thread_usage{};
+    auto lock = std::lock_guard(m_mutex);
+    m_usage.cpu_ns += after.cpu_ns - before.cpu_ns;
+    m_usage.alloc_count += after.alloc_count - before.alloc_count;
+    m_usage.alloc_bytes += after.alloc_bytes - before.alloc_bytes;
+    m_usage.live_bytes += after.live_bytes - before.live_bytes;
+    if (--m_busy == 0) {
+      m_done.notify_one();
+    }
+  }
+}
+
+void task_scheduler::drain(size_t self)
+{
+  for (size_t chunk = 0; pop(self, chunk) || steal(self, chunk);) {
+    if (m_failed.load(std::memory_order_relaxed)) {
+      continue;
+    }
+    try {
+      m_body(m_context, chunk);
+    } catch (...) {
+      auto lock = std::lock_guard(m_mutex);
+      if (!m_error) {
+        m_error = std::current_exception();
+      }
+      m_failed = true;
+    }
+  }
+}
+
+bool task_scheduler::pop(size_t self, size_t& chunk)
+{
+  std::atomic<uint64_t>& range = m_queues[self].range;
+  for (uint64_t cur = range.load(); ;) {
+    const uint64_t begin = cur >> 32;
+    const uint64_t end = cur & 0xffffffff;
+    if (begin == end) {
+      return false;
+    }
+    if (range.compare_exchange_weak(cur, pack_range(begin, end - 1))) {
+      chunk = end - 1;
+      return true;
+    }
+  }
+}
+
+// A thread only steals once its own range is empty, so that it can replace it without racing other thieves
+bool task_scheduler::steal(size_t self, size_t& chunk)
+{
+  const size_t count = threads();
+  for (size_t offset = 1; offset < count; ++offset) {
+    std::atomic<uint64_t>& victim = m_queues[(self + offset) % count].range;
+    for (uint64_t cur = victim.load(); ;) {
+      const uint64_t begin = cur >> 32;
+      const uint64_t end = cur & 0xffffffff;
+      if (begin == end) {
+        break;
+      }
+      const uint64_t taken = (end - begin + 1) / 2;
+      if (victim.compare_exchange_weak(cur, pack_range(begin + taken, end))) {
+        chunk = begin;
+        m_queues[self].range = pack_range(begin + 1, begin + taken);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+task_scheduler& parallel_scheduler()
+{
+  static task_scheduler sent(std::max(std::thread::hardware_concurrency(), 1u));
+  return sent;
+}
+
+void set_parallelism(size_t threads)
+{
+  parallel_scheduler().set_threads(threads);
+}
+
+#ifdef AOS_TESTS
+#include <sstream>
+
+namespace {
+
+std::vector<std::string_view> split_lines(std::string_view text) {
+  std::vector<std::string_view> sent;
+  for (std::string_view line : lines(text)) {
+    sent.push_back(line);
+  }
+  return sent;
+}
+
+}
+
+TEST(utils, lines) {
+  EXPECT_TRUE(split_lines("").empty());
+  EXPECT_EQ(split_lines("a\nbc\n"), (std::vector<std::string_view>{ "a", "bc" }));
+  EXPECT_EQ(split_lines("a\n\nbc"), (std::vector<std::string_view>{ "a", "", "bc" }));
+
+  // Lines spanning several 64 bytes blocks, and blocks without any newline
+  std::string text;
+  std::vector<std::string> expected;
+  for (size_t len : { 0, 1, 63, 64, 65, 130, 7 }) {
+    expected.push_back(std::string(len, 'x'));
+    text += expected.back() + '\n';
+  }
+  text += "last";
+  expected.push_back("last");
+  auto res = split_lines(text);
+  ASSERT_EQ(res.size(), expected.size());
+  for (size_t i = 0; i < res.size(); ++i) {
+    EXPECT_EQ(res[i], expected[i]) << " i == " << i;
+  }
+}
+
+TEST(utils, integers) {
+  auto [a, b, c, d] = scan_integers<int64_t, 4>("Sensor at x=2, y=-18: closest beacon is at x=-2, y=15");
+  EXPECT_EQ(a, 2);
+  EXPECT_EQ(b, -18);
+  EXPECT_EQ(c, -2);
+  EXPECT_EQ(d, 15);
+
+  auto [l, r] = scan_integers<uint64_t, 2>("20-61");
+  EXPECT_EQ(l, 20);
+  EXPECT_EQ(r, 61);
+
+  EXPECT_THROW((scan_integers<int, 3>("1,2")), std::runtime_error);
+
+  // Numbers crossing the 64 bytes blocks
+  std::string text;
+  std::vector<int64_t> expected;
+  for (int64_t i = 0; i < 200; ++i) {
+    expected.push_back(i % 3 == 0 ? -i * 7919 : i * 104729);
+    text += std::to_string(expected.back()) + (i % 5 == 0 ? "\n" : ", ");
+  }
+  std::vector<int64_t> res;
+  for_each_integer<int64_t>(text, [&res](int64_t v) { res.push_back(v); });
+  EXPECT_EQ(res, expected);
+}
+
+TEST(utils, match_pattern) {
+  auto move = match_pattern<"move {u} from {u} to {u}">("move 13 from 2 to 9");
+  ASSERT_TRUE(move);
+  EXPECT_EQ(*move, std::make_tuple(uint64_t{ 13 }, uint64_t{ 2 }, uint64_t{ 9 }));
+  EXPECT_FALSE(match_pattern<"move {u} from {u} to {u}">("move 13 from 2 to 9 "));
+  EXPECT_FALSE(match_pattern<"move {u} from {u} to {u}">("move -1 from 2 to 9"));
+  EXPECT_FALSE(match_pattern<"move {u} from {u} to {u}">("move 1 from 2"));
+
+  auto sensor = match_pattern<"x={i}, y={i}">("x=-2, y=15");
+  ASSERT_TRUE(sensor);
+  EXPECT_EQ(*sensor, std::make_tuple(int64_t{ -2 }, int64_t{ 15 }));
+
+  auto valve = match_pattern<"Valve {w} has flow rate={u}; tunnels lead to valves {*}">("Valve AA has flow rate=0; tunnels lead to valves DD, II, BB");
+  ASSERT_TRUE(valve);
+  auto [name, rate, valves] = *valve;
+  EXPECT_EQ(name, "AA");
+  EXPECT_EQ(rate, 0);
+  EXPECT_EQ(valves, "DD, II, BB");
+
+  auto cost = match_pattern<"costs {*} and {w}">("costs 3 ore and clay");
+  ASSERT_TRUE(cost);
+  EXPECT_EQ(std::get<0>(*cost), "3 ore");
+  EXPECT_EQ(std::get<1>(*cost), "clay");
+
+  EXPECT_TRUE(match_pattern<"no capture">("no capture"));
+}
+
+TEST(utils, grid2d) {
+  const std::string lines[] = { "ab", "cde" };
+  auto grid = grid2d<char>::from_lines(lines, [](char c) { return static_cast<char>(c - 'a' + 'A'); }, '.', 1, '#');
+  EXPECT_EQ(grid.width(), 3);
+  EXPECT_EQ(grid.height(), 2);
+  EXPECT_EQ(std::string(grid.row(0).begin(), grid.row(0).end()), "AB.");
+  EXPECT_EQ(std::string(grid.row(1).begin(), grid.row(1).end()), "CDE");
+  EXPECT_EQ(grid(-1, -1), '#');
+  EXPECT_EQ(grid(3, 1), '#');
+  EXPECT_TRUE(grid.contains(2, 1));
+  EXPECT_FALSE(grid.contains(3, 1));
+  EXPECT_TRUE(grid.contains_padded(3, 2));
+  EXPECT_EQ(grid.cells().size(), 5 * 4);
+
+  // Neighbors of a corner reach into the border
+  const auto corner = grid.index_of(0, 0);
+  EXPECT_EQ(grid.pos_of(corner), std::make_pair(grid2d<char>::index_t{ 0 }, grid2d<char>::index_t{ 0 }));
+  std::string neighbors;
+  grid.for_each_neighbor(corner, [&](auto i) { neighbors.push_back(grid[i]); });
+  EXPECT_EQ(neighbors, "#BC#");
+
+  auto bits = grid2d<bool>(70, 3, false, 1, true);
+  EXPECT_EQ(bits.count(), 0);
+  EXPECT_TRUE(bits(-1, 0));
+  EXPECT_TRUE(bits(70, 2));
+  bits.set(69, 2, true);
+  bits.set(bits.index_of(0, 1), true);
+  EXPECT_TRUE(bits(69, 2));
+  EXPECT_TRUE(bits(0, 1));
+  EXPECT_FALSE(bits(1, 1));
+  EXPECT_EQ(bits.count(), 2);
+  bits.set(69, 2, false);
+  EXPECT_EQ(bits.count(), 1);
+  EXPECT_EQ(grid2d<bool>(5, 5, true).count(), 25);
+}
+
+TEST(utils, bfs) {
+  // States 0 to 9 on a line, 5 being a wall
+  auto line = [](size_t s, auto&& emit) {
+    if (s > 0 && s != 6) { emit(s - 1); }
+    if (s < 9 && s != 4) { emit(s + 1); }
+  };
+  auto bfs = bfs_engine();
+  const size_t from_0[] = { 0 };
+  EXPECT_EQ(bfs.search(10, from_0, line, [](size_t s) { return s == 3; }), 3);
+  EXPECT_EQ(bfs.search(10, from_0, line, [](size_t s) { return s == 0; }), 0);
+  EXPECT_EQ(bfs.search(10, from_0, line, [](size_t s) { return s == 7; }), std::nullopt);
+
+  const size_t from_both_ends[] = { 0, 9 };
+  EXPECT_EQ(bfs.search(10, from_both_ends, line, [](size_t s) { return s == 7; }), 2);
+
+  auto depths = std::vector<size_t>(10, 0);
+  size_t visited = 0;
+  bfs.flood(10, from_both_ends, line, [&](size_t s, size_t depth) { depths[s] = depth; ++visited; });
+  EXPECT_EQ(visited, 9);
+  EXPECT_EQ(depths, std::vector<size_t>({ 0, 1, 2, 3, 4, 0, 3, 2, 1, 0 }));
+
+  // Revisiting at every layer, waiting keeps the states of the previous layer in the frontier
+  auto wait_then_move = [](size_t s, auto&& emit) {
+    emit(s);
+    if (s < 9) { emit(s + 1); }
+  };
+  std::vector<size_t> layers;
+  auto on_layer = [&](size_t depth) { layers.push_back(depth); };
+  EXPECT_EQ(bfs.search(10, from_0, wait_then_move, [](size_t s) { return s == 2; }, bfs_engine::revisit::each_layer, on_layer), 2);
+  EXPECT_EQ(layers, std::vector<size_t>({ 1, 2 }));
+  EXPECT_EQ(bfs.frontier().size(), 2);
+}
+
+namespace {
+  struct cube_t {
+    int x = 0, y = 0, z = 0;
+
+    bool operator==(const cube_t&) const = default;
+  };
+
+  uint64_t pack_key(const cube_t& c) {
+    return pack_coords(c.x, c.y, c.z);
+  }
+}
+
+TEST(utils, flat_hash) {
+  EXPECT_NE(pack_coords(1, -1), pack_coords(-1, 1));
+  EXPECT_NE(pack_coords(0, 0, -1), pack_coords(0, -1, 0));
+
+  auto set = flat_hash_set<cube_t>();
+  EXPECT_FALSE(set.contains({}));
+  for (int i = -50; i < 50; ++i) {
+    EXPECT_TRUE(set.insert({ i, -i, i % 7 }).second);
+  }
+  EXPECT_FALSE(set.insert({ 3, -3, 3 }).second);
+  EXPECT_EQ(set.size(), 100);
+  EXPECT_EQ(std::ranges::distance(set), 100);
+  EXPECT_TRUE(set.contains({ -50, 50, -1 }));
+  EXPECT_FALSE(set.contains({ -50, 50, 1 }));
+
+  // Erased keys leave tombstones, which neither end the probes nor are found
+  for (int i = -50; i < 50; i += 2) {
+    EXPECT_EQ(set.erase({ i, -i, i % 7 }), 1);
+  }
+  EXPECT_EQ(set.erase({ -50, 50, -1 }), 0);
+  EXPECT_EQ(set.size(), 50);
+  EXPECT_TRUE(set.contains({ 49, -49, 0 }));
+  EXPECT_FALSE(set.contains({ 48, -48, 6 }));
+  for (int round = 0; round < 100; ++round) {
+    set.insert({ 1000, round, 0 });
+    set.erase({ 1000, round, 0 });
+  }
+  EXPECT_EQ(set.size(), 50);
+  EXPECT_LE(set.capacity(), 256);
+
+  auto copy = flat_hash_set<cube_t>(set, std::pmr::new_delete_resource());
+  EXPECT_EQ(copy, set);
+  copy.insert({});
+  EXPECT_NE(copy, set);
+  copy.clear();
+  EXPECT_TRUE(copy.empty());
+  EXPECT_EQ(copy.begin(), copy.end());
+
+  auto map = flat_hash_map<cube_t, size_t>{ { { 1, 2, 3 }, 4 } };
+  map[{ 1, 2, 3 }] += 1;
+  map[{ 3, 2, 1 }] += 1;
+  EXPECT_FALSE(map.try_emplace({ 3, 2, 1 }, 10).second);
+  EXPECT_TRUE(map.try_emplace({ 0, 0, 0 }, 10).second);
+  EXPECT_EQ(map.at({ 1, 2, 3 }), 5);
+  EXPECT_EQ(map.at({ 3, 2, 1 }), 1);
+  EXPECT_THROW(map.at({ 2, 2, 2 }), std::out_of_range);
+  EXPECT_EQ(ranges::reduce(map | std::views::values), 16);
+  EXPECT_EQ(map.erase({ 0, 0, 0 }), 1);
+  EXPECT_TRUE(map.try_emplace({ 0, 0, 0 }).second);
+  EXPECT_EQ(map.at({ 0, 0, 0 }), 0);
+}
+
+TEST(utils, task_scheduler) {
+  auto scheduler = task_scheduler(4);
+  EXPECT_EQ(scheduler.threads(), 4);
+  for (size_t chunks : { 0, 1, 3, 1000 }) {
+    auto runs = std::vector<std::atomic<int>>(chunks);
+    scheduler.run(chunks, [&](size_t chunk) {
+      // Uneven chunks, so that threads run out of their own and steal
+      if (chunk % 7 == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      ++runs[chunk];
+    });
+    EXPECT_TRUE(std::ranges::all_of(runs, [](const std::atomic<int>& r) { return r == 1; }));
+  }
+
+  // Loops started from a loop run inline
+  auto inner = std::atomic<size_t>{ 0 };
+  scheduler.run(8, [&](size_t) {
+    scheduler.run(8, [&](size_t) { ++inner; });
+  });
+  EXPECT_EQ(inner, 64);
+
+  auto started = std::atomic<size_t>{ 0 };
+  EXPECT_THROW(scheduler.run(100, [&](size_t chunk) {
+    ++started;
+    if (chunk == 0) {
+      throw std::runtime_error("chunk 0");
+    }
+  }), std::runtime_error);
+  EXPECT_GE(started, 1);
+
+  scheduler.run(8, [&](size_t) {
+    EXPECT_THROW(scheduler.set_threads(2), std::logic_error);
+  });
+  scheduler.set_threads(2);
+  EXPECT_EQ(scheduler.threads(), 2);
+  auto runs = std::vector<std::atomic<int>>(100);
+  scheduler.run(runs.size(), [&](size_t chunk) { ++runs[chunk]; });
+  EXPECT_TRUE(std::ranges::all_of(runs, [](const std::atomic<int>& r) { return r == 1; }));
+}
+
+TEST(utils, parallel_reduce) {
+  // Not commutative, so that the result shows the order of the reduction
+  auto concat = [](std::string l, const std::string& r) { return l + r; };
+  auto digit = [](size_t i) { return std::to_string(i % 10); };
+  auto expected = std::string();
+  for (size_t i = 0; i < 1000; ++i) {
+    expected += digit(i);
+  }
+  for (size_t threads : { 1, 3, 8 }) {
+    set_parallelism(threads);
+    EXPECT_EQ(parallel_reduce(1000, std::string(), digit, concat), expected);
+    EXPECT_EQ(parallel_reduce(1000, std::string(), digit, concat, 7), expected);
+    auto squares = std::vector<size_t>(100);
+    parallel_for(squares.size(), [&](size_t i) { squares[i] = i * i; });
+    EXPECT_EQ(ranges::reduce(squares), 328350);
+  }
+  set_parallelism(std::max(std::thread::hardware_concurrency(), 1u));
+}
+
+TEST(utils, cycle) {
+  // x -> x * x + 1 mod 255 from 3: 3, 10, 101, 2, 5, 26, 167, 95, 101, ...
+  auto step = [](uint64_t& x) { x = (x * x + 1) % 255; };
+  const auto expected = cycle_t{ .start = 2, .period = 6 };
+  EXPECT_EQ(find_cycle(uint64_t{ 3 }, step), expected);
+  EXPECT_EQ(find_cycle(uint64_t{ 3 }, step, cycle_search::floyd), expected);
+  EXPECT_EQ(find_cycle(uint64_t{ 101 }, step, cycle_search::floyd), cycle_t(0, 6));
+  EXPECT_EQ(find_cycle(uint64_t{ 0 }, [](uint64_t&) {}), cycle_t(0, 1));
+
+  auto detector = cycle_detector();
+  std::vector<uint64_t> states;
+  std::optional<cycle_t> found;
+  for (uint64_t x = 3; !found; step(x)) {
+    // Colliding fingerprints, all states are compared
+    found = detector.add(x % 2, [&](size_t earlier) { return states[earlier] == x; });
+    states.push_back(x);
+  }
+  EXPECT_EQ(found, expected);
+  EXPECT_EQ(detector.steps(), 8);
+
+  EXPECT_EQ(expected.fold(1), 1);
+  EXPECT_EQ(expected.fold(8), 2);
+  EXPECT_EQ(expected.fold(15), 3);
+  // Growing by 6, the period, every period from the start of the cycle
+  auto value_at = [](size_t step) { return step < 2 ? int64_t{ 0 } : static_cast<int64_t>(step); };
+  EXPECT_EQ(expected.extrapolate(7, value_at), 7);
+  EXPECT_EQ(expected.extrapolate(8, value_at), 8);
+  EXPECT_EQ(expected.extrapolate(15, value_at), 3 + 2 * 6);
+
+  EXPECT_NE(fingerprint_t().add(1).add(2).value(), fingerprint_t().add(2).add(1).value());
+  const uint8_t bytes[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  EXPECT_NE(fingerprint_t().add(bytes).value(), fingerprint_t().add(std::span(bytes).first(8)).value());
+}
+
+#if AOS_TRACE
+TEST(utils, trace) {
+  trace::start();
+  {
+    AOS_TRACE_SCOPE("outer");
+    AOS_TRACE_SCOPE("inner \"quoted\"");
+  }
+  task_scheduler(2).run(4, [](size_t) {
+    AOS_TRACE_SCOPE("task");
+  });
+  trace::stop();
+  {
+    AOS_TRACE_SCOPE("stopped");
+  }
+
+  auto out = std::ostringstream();
+  trace::write_json(out);
+  const std::string json = out.str();
+  auto count = [&json](std::string_view s) {
+    size_t sent = 0;
+    for (size_t pos = json.find(s); pos != std::string::npos; pos = json.find(s, pos + 1)) {
+      ++sent;
+    }
+    return sent;
+  };
+  EXPECT_EQ(count("\"ph\":\"X\""), 6);
+  EXPECT_EQ(count("\"name\":\"outer\""), 1);
+  EXPECT_EQ(count("\"name\":\"inner \\\"quoted\\\"\""), 1);
+  EXPECT_EQ(count("\"name\":\"task\""), 4);
+  EXPECT_EQ(count("stopped"), 0);
+  EXPECT_EQ(count("\"dropped_events\":0"), 1);
+}
+#endif
+#endif
+
+#ifdef AOS_KERNEL_BENCH
+#include <regex>
+#include <set>
+
+// Parse throughput of match_pattern against the std::regex it replaced in the days, over generated inputs
+void parse_regex(benchmark::State& state, const char* day, const char* pattern) {
+  const auto input = generated_input(day, state.range(0));
+  const auto re = std::regex(pattern);
+  for (auto _ : state) {
+    int64_t total = 0;
+    for (std::string_view line : lines(input)) {
+      std::match_results<std::string_view::const_iterator> matches;
+      if (std::regex_match(line.begin(), line.end(), matches, re)) {
+        for (size_t i = 1; i < matches.size(); ++i) {
+          total += string_view_to<int64_t>(std::string_view(matches[i].first, matches[i].second));
+        }
+      }
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+template<pattern_t P>
+void parse_pattern(benchmark::State& state, const char* day) {
+  const auto input = generated_input(day, state.range(0));
+  for (auto _ : state) {
+    int64_t total = 0;
+    for (std::string_view line : lines(input)) {
+      if (auto m = match_pattern<P>(line)) {
+        std::apply([&total](auto... captures) { total += (0 + ... + static_cast<int64_t>(captures)); }, *m);
+      }
+    }
+    benchmark::DoNotOptimize(total);
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+void parse_d05_regex(benchmark::State& state) {
+  parse_regex(state, "d05", R"(move (\d+) from (\d+) to (\d+))");
+}
+void parse_d05_pattern(benchmark::State& state) {
+  parse_pattern<"move {u} from {u} to {u}">(state, "d05");
+}
+void parse_d15_regex(benchmark::State& state) {
+  parse_regex(state, "d15", R"(Sensor at x=(-?\d+), y=(-?\d+): closest beacon is at x=(-?\d+), y=(-?\d+))");
+}
+void parse_d15_pattern(benchmark::State& state) {
+  parse_pattern<"Sensor at x={i}, y={i}: closest beacon is at x={i}, y={i}">(state, "d15");
+}
+BENCHMARK(parse_d05_regex)->Arg(1)->Arg(16);
+BENCHMARK(parse_d05_pattern)->Arg(1)->Arg(16);
+BENCHMARK(parse_d15_regex)->Arg(1)->Arg(16);
+BENCHMARK(parse_d15_pattern)->Arg(1)->Arg(16);
+
+namespace {
+  struct head_pos_t {
+    int64_t x = 0, y = 0;
+
+    auto operator<=>(const head_pos_t&) const = default;
+  };
+
+  uint64_t pack_key(const head_pos_t& p) {
+    return pack_coords(p.x, p.y);
+  }
+}
+
+// Positions visited by the head of d09's rope, in the std::set the coordinate days used against flat_hash_set
+template<typename Set>
+void visited_positions(benchmark::State& state) {
+  const auto input = generated_input("d09", state.range(0));
+  size_t moves = 0;
+  for (auto _ : state) {
+    auto visited = Set();
+    auto head = head_pos_t{};
+    moves = 0;
+    for (std::string_view line : lines(input)) {
+      for (int64_t steps = string_view_to<int64_t>(line.substr(2)); steps > 0; --steps, ++moves) {
+        switch (line[0]) {
+        case 'R': ++head.x; break;
+        case 'U': --head.y; break;
+        case 'L': --head.x; break;
+        case 'D': ++head.y; break;
+        }
+        visited.insert(head);
+      }
+    }
+    benchmark::DoNotOptimize(visited.size());
+  }
+  state.SetItemsProcessed(state.iterations() * moves);
+}
+BENCHMARK_TEMPLATE(visited_positions, std::set<head_pos_t>)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(visited_positions, flat_hash_set<head_pos_t>)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMillisecond);
+#endif
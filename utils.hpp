@@ -7,6 +7,41 @@
 #include <fstream>
 #include <ranges>
 #include <numeric>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <concepts>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <iosfwd>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AOS_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AOS_SSE2 1
+#endif
 
 template<typename V, typename... F>
 auto match(V&& v, F&&... f) {
@@ -17,6 +52,7 @@ auto match(V&& v, F&&... f) {
   return std::visit(overload, std::forward<V>(v));
 }
 
+// Sized up front when `file` can be seeked, else read by chunks until its end, for pipes
 inline std::optional<std::string> read_all_file(std::istream& file) {
   std::optional<std::string> sent;
   if (file.seekg(0, std::ios_base::end))
@@ -26,6 +62,16 @@ inline std::optional<std::string> read_all_file(std::istream& file) {
       return std::nullopt;
     sent.emplace().resize(file_size);
     file.read(sent->data(), file_size);
+    return sent;
+  }
+  file.clear();
+  sent.emplace();
+  char chunk[1 << 14];
+  while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0) {
+    sent->append(chunk, static_cast<size_t>(file.gcount()));
+  }
+  if (file.bad()) {
+    return std::nullopt;
   }
   return sent;
 }
@@ -67,4 +113,1213 @@ T sign_of(T v) {
     return 0;
   }
   return -1;
-}
\ No newline at end of file
+}
+
+namespace simd {
+  // Bit i is set when s[i] == c, for the first 64 bytes of s (or fewer when s is shorter)
+  inline uint64_t match_mask(std::string_view s, char c) {
+    uint64_t sent = 0;
+    size_t i = 0;
+    if (s.size() >= 64) {
+#if AOS_AVX2
+      const __m256i needle = _mm256_set1_epi8(c);
+      for (; i < 64; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.data() + i));
+        sent |= uint64_t{ static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle))) } << i;
+      }
+#elif AOS_SSE2
+      const __m128i needle = _mm_set1_epi8(c);
+      for (; i < 64; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+        sent |= uint64_t{ static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle))) } << i;
+      }
+#endif
+    }
+    for (; i < std::min<size_t>(s.size(), 64); ++i) {
+      sent |= uint64_t{ s[i] == c } << i;
+    }
+    return sent;
+  }
+
+  // Bit i is set when s[i] is a decimal digit, for the first 64 bytes of s (or fewer when s is shorter)
+  inline uint64_t digit_mask(std::string_view s) {
+    uint64_t sent = 0;
+    size_t i = 0;
+    if (s.size() >= 64) {
+      // Signed comparisons are fine, bytes above 0x7f are negative and so not digits
+#if AOS_AVX2
+      const __m256i below = _mm256_set1_epi8('0' - 1);
+      const __m256i above = _mm256_set1_epi8('9' + 1);
+      for (; i < 64; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.data() + i));
+        const __m256i digits = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, below), _mm256_cmpgt_epi8(above, chunk));
+        sent |= uint64_t{ static_cast<uint32_t>(_mm256_movemask_epi8(digits)) } << i;
+      }
+#elif AOS_SSE2
+      const __m128i below = _mm_set1_epi8('0' - 1);
+      const __m128i above = _mm_set1_epi8('9' + 1);
+      for (; i < 64; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+        const __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chunk, below), _mm_cmplt_epi8(chunk, above));
+        sent |= uint64_t{ static_cast<uint16_t>(_mm_movemask_epi8(digits)) } << i;
+      }
+#endif
+    }
+    for (; i < std::min<size_t>(s.size(), 64); ++i) {
+      sent |= uint64_t{ s[i] >= '0' && s[i] <= '9' } << i;
+    }
+    return sent;
+  }
+
+  // Bit i is set when bytes[i] == b, for the 16 bytes at `bytes`
+  inline uint32_t match_mask16(const int8_t* bytes, int8_t b) {
+#if AOS_SSE2
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+    return static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(b))));
+#else
+    uint32_t sent = 0;
+    for (size_t i = 0; i < 16; ++i) {
+      sent |= uint32_t{ bytes[i] == b } << i;
+    }
+    return sent;
+#endif
+  }
+
+  // Bit i is set when bytes[i] is negative, for the 16 bytes at `bytes`
+  inline uint32_t sign_mask16(const int8_t* bytes) {
+#if AOS_SSE2
+    return static_cast<uint16_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes))));
+#else
+    uint32_t sent = 0;
+    for (size_t i = 0; i < 16; ++i) {
+      sent |= uint32_t{ bytes[i] < 0 } << i;
+    }
+    return sent;
+#endif
+  }
+}
+
+// Lines of a text as views into it, without their '\n', like successive std::getline would give them
+class lines_view : public std::ranges::view_interface<lines_view> {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    explicit iterator(std::string_view text)
+      : m_text(text)
+      , m_newlines(simd::match_mask(text, '\n'))
+    {
+      next();
+    }
+
+    std::string_view operator*() const { return m_line; }
+
+    iterator& operator++() {
+      next();
+      return *this;
+    }
+
+    iterator operator++(int) {
+      auto sent = *this;
+      next();
+      return sent;
+    }
+
+    bool operator==(const iterator& r) const { return m_end == r.m_end && (m_end || m_line.data() == r.m_line.data()); }
+    bool operator==(std::default_sentinel_t) const { return m_end; }
+
+  private:
+    // Newlines are located a block of 64 bytes at a time, `m_newlines` holding those of the current block not consumed yet
+    void next() {
+      m_end = m_start >= m_text.size();
+      if (m_end) {
+        return;
+      }
+      while (m_newlines == 0) {
+        m_block += 64;
+        if (m_block >= m_text.size()) {
+          m_line = m_text.substr(m_start);
+          m_start = m_text.size();
+          return;
+        }
+        m_newlines = simd::match_mask(m_text.substr(m_block), '\n');
+      }
+      size_t eol = m_block + std::countr_zero(m_newlines);
+      m_newlines &= m_newlines - 1;
+      m_line = m_text.substr(m_start, eol - m_start);
+      m_start = eol + 1;
+    }
+
+    std::string_view m_text;
+    std::string_view m_line;
+    size_t m_start = 0;
+    size_t m_block = 0;
+    uint64_t m_newlines = 0;
+    bool m_end = true;
+  };
+
+  lines_view() = default;
+  explicit lines_view(std::string_view text)
+    : m_text(text)
+  {}
+
+  iterator begin() const { return iterator(m_text); }
+  std::default_sentinel_t end() const { return {}; }
+
+private:
+  std::string_view m_text;
+};
+
+inline lines_view lines(std::string_view text) {
+  return lines_view(text);
+}
+
+// Calls `f(n)` for every integer of `s`, in order, digits being located 64 bytes at a time.
+// With a signed T, a '-' right before the digits makes the number negative
+template<std::integral T, typename F>
+void for_each_integer(std::string_view s, F&& f) {
+  size_t resume = 0;
+  for (size_t block = 0; block < s.size(); block += 64) {
+    uint64_t digits = simd::digit_mask(s.substr(block));
+    // Skips the digits of a number started in a previous block
+    if (resume > block) {
+      digits &= resume - block >= 64 ? 0 : ~uint64_t{ 0 } << (resume - block);
+    }
+    while (digits != 0) {
+      size_t i = block + std::countr_zero(digits);
+      bool negative = std::is_signed_v<T> && i > 0 && s[i - 1] == '-';
+      T value = 0;
+      for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; ++i) {
+        value = value * 10 + static_cast<T>(s[i] - '0');
+      }
+      f(negative ? static_cast<T>(-value) : value);
+      resume = i;
+      digits &= i - block >= 64 ? 0 : ~uint64_t{ 0 } << (i - block);
+    }
+  }
+}
+
+// The first N integers of `s`, throws like string_view_to when there are fewer
+template<std::integral T, size_t N>
+std::array<T, N> scan_integers(std::string_view s) {
+  std::array<T, N> sent{};
+  size_t count = 0;
+  for_each_integer<T>(s, [&](T value) {
+    if (count < N) {
+      sent[count] = value;
+    }
+    ++count;
+  });
+  if (count < N) {
+    throw std::runtime_error("parse error");
+  }
+  return sent;
+}
+
+// Literal text with typed captures, checked at compile time:
+// {u} an unsigned integer, {i} a signed one, {w} a word of letters and digits,
+// {*} anything up to the literal text that follows it, or the end of the input
+template<size_t N>
+struct pattern_t {
+  char chars[N]{};
+
+  consteval pattern_t(const char (&s)[N]) {
+    std::copy_n(s, N, chars);
+    for (size_t i = 0; i + 1 < N; ++i) {
+      if (chars[i] == '{') {
+        if (i + 3 >= N || chars[i + 2] != '}' || !std::string_view("uiw*").contains(chars[i + 1])) {
+          throw std::logic_error("invalid capture");
+        }
+        ++captures;
+        i += 2;
+      }
+    }
+  }
+
+  constexpr std::string_view view() const { return { chars, N - 1 }; }
+
+  size_t captures = 0;
+};
+
+namespace pattern_detail {
+  template<char Kind> struct capture;
+  template<> struct capture<'u'> { using type = uint64_t; };
+  template<> struct capture<'i'> { using type = int64_t; };
+  template<> struct capture<'w'> { using type = std::string_view; };
+  template<> struct capture<'*'> { using type = std::string_view; };
+
+  // The kinds of the captures of P, and the literal text around them: literals[i] precedes capture i
+  template<pattern_t P>
+  struct layout {
+    std::array<char, P.captures> kinds{};
+    std::array<std::string_view, P.captures + 1> literals{};
+
+    consteval layout() {
+      std::string_view p = P.view();
+      size_t start = 0;
+      size_t n = 0;
+      for (size_t i = 0; i < p.size(); ++i) {
+        if (p[i] == '{') {
+          literals[n] = p.substr(start, i - start);
+          kinds[n++] = p[i + 1];
+          i += 2;
+          start = i + 1;
+        }
+      }
+      literals[n] = p.substr(start);
+    }
+  };
+
+  template<pattern_t P, size_t... I>
+  auto captures_of(std::index_sequence<I...>) -> std::tuple<typename capture<layout<P>{}.kinds[I]>::type...>;
+
+  template<pattern_t P>
+  using captures_t = decltype(captures_of<P>(std::make_index_sequence<P.captures>{}));
+
+  inline bool consume(std::string_view& s, std::string_view literal) {
+    if (!s.starts_with(literal)) {
+      return false;
+    }
+    s.remove_prefix(literal.size());
+    return true;
+  }
+
+  template<char Kind, typename T>
+  bool read(std::string_view& s, std::string_view next_literal, T& out) {
+    if constexpr (std::is_integral_v<T>) {
+      auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+      if (ec != std::errc()) {
+        return false;
+      }
+      s.remove_prefix(ptr - s.data());
+      return true;
+    } else if constexpr (Kind == 'w') {
+      size_t len = 0;
+      while (len < s.size() && std::isalnum(static_cast<unsigned char>(s[len]))) {
+        ++len;
+      }
+      out = s.substr(0, len);
+      s.remove_prefix(len);
+      return len > 0;
+    } else {
+      size_t len = next_literal.empty() ? s.size() : s.find(next_literal);
+      if (len == std::string_view::npos) {
+        return false;
+      }
+      out = s.substr(0, len);
+      s.remove_prefix(len);
+      return true;
+    }
+  }
+}
+
+// The captures of P when the whole of `s` matches it, without allocating.
+// Words and {*} captures are views into `s`.
+//   if (auto m = match_pattern<"move {u} from {u} to {u}">(line)) { auto [count, from, to] = *m; }
+template<pattern_t P>
+std::optional<pattern_detail::captures_t<P>> match_pattern(std::string_view s) {
+  static constexpr auto layout = pattern_detail::layout<P>{};
+  pattern_detail::captures_t<P> sent;
+  bool matched = pattern_detail::consume(s, layout.literals[0])
+    && [&]<size_t... I>(std::index_sequence<I...>) {
+      return (... && (pattern_detail::read<layout.kinds[I]>(s, layout.literals[I + 1], std::get<I>(sent))
+        && pattern_detail::consume(s, layout.literals[I + 1])));
+    }(std::make_index_sequence<P.captures>{});
+  if (!matched || !s.empty()) {
+    return std::nullopt;
+  }
+  return sent;
+}
+
+// What a thread has spent so far, as counted by the harness
+struct thread_usage {
+  int64_t cpu_ns = 0;
+  uint64_t alloc_count = 0;
+  uint64_t alloc_bytes = 0;
+  int64_t live_bytes = 0;
+};
+
+// Reads and adds to the usage of the calling thread. Set by the harness, so that what the workers of a task_scheduler
+// spend on a loop is added to the thread that started it, whose stage measurements then include its parallel loops
+struct usage_hooks {
+  thread_usage (*read)() = nullptr;
+  void (*add)(const thread_usage& usage) = nullptr;
+};
+void set_usage_hooks(usage_hooks hooks);
+
+// Pool of threads running the parallel loops inside a day, with the thread starting a loop. The chunks of a loop are
+// dealt in contiguous ranges, each thread running its own from the back, then stealing half of what another has left
+// from the front
+class task_scheduler {
+public:
+  // `threads` counts the thread starting the loops, with 1 they run inline
+  explicit task_scheduler(size_t threads);
+  ~task_scheduler();
+
+  task_scheduler(const task_scheduler&) = delete;
+  task_scheduler& operator=(const task_scheduler&) = delete;
+
+  size_t threads() const { return m_workers.size() + 1; }
+
+  // Restarts the pool with `threads` threads, once the loop running on it if any is done. Throws when called from
+  // one of its loops
+  void set_threads(size_t threads);
+
+  // Calls `body(chunk)` for every chunk in [0, chunks) and returns once all are done, rethrowing the first exception
+  // thrown, the chunks not started by then being skipped. Loops started from a loop, or while another thread's loop
+  // runs, run inline
+  template<typename F>
+  void run(size_t chunks, F&& body) {
+    run_erased(chunks, [](void* f, size_t chunk) { (*static_cast<std::remove_reference_t<F>*>(f))(chunk); }, &body);
+  }
+
+private:
+  // Chunks [begin, end) of a thread, begin in the high half
+  struct alignas(64) queue_t {
+    std::atomic<uint64_t> range{ 0 };
+  };
+
+  void run_erased(size_t chunks, void (*body)(void*, size_t), void* context);
+  void work(std::stop_token stop, size_t self, uint64_t seen);
+  void drain(size_t self);
+  bool pop(size_t self, size_t& chunk);
+  bool steal(size_t self, size_t& chunk);
+
+  std::unique_ptr<queue_t[]> m_queues;
+  std::mutex m_running;
+  std::mutex m_mutex;
+  std::condition_variable_any m_wake;
+  std::condition_variable m_done;
+  uint64_t m_generation = 0;
+  size_t m_busy = 0;
+  void (*m_body)(void*, size_t) = nullptr;
+  void* m_context = nullptr;
+  // Spent by the workers on the running loop
+  thread_usage m_usage;
+  std::atomic<bool> m_failed{ false };
+  std::exception_ptr m_error;
+  std::vector<std::jthread> m_workers;
+};
+
+// Scheduler of parallel_for and parallel_reduce, one thread per core until set_parallelism is called
+task_scheduler& parallel_scheduler();
+
+// Thread count of parallel_scheduler(), see task_scheduler::set_threads
+void set_parallelism(size_t threads);
+
+namespace parallel_detail {
+  // Iterations per chunk, from `count` only so that reductions do not depend on the thread count
+  inline size_t grain_of(size_t count, size_t grain) {
+    return grain > 0 ? grain : std::max<size_t>(1, count / 256);
+  }
+}
+
+// Calls `f(i)` for every i in [0, count), by chunks of `grain` iterations run on the threads of parallel_scheduler()
+template<typename F>
+void parallel_for(size_t count, F&& f, size_t grain = 0) {
+  grain = parallel_detail::grain_of(count, grain);
+  parallel_scheduler().run((count + grain - 1) / grain, [&](size_t chunk) {
+    for (size_t i = chunk * grain; i < std::min(count, (chunk + 1) * grain); ++i) {
+      f(i);
+    }
+  });
+}
+
+// `reduce` of `map(i)` for every i in [0, count), `init` being its identity. Each chunk folds its iterations in order,
+// then the chunk results are folded in order, so that the result is the same whatever the thread count
+template<typename T, typename Map, typename Reduce>
+T parallel_reduce(size_t count, T init, Map&& map, Reduce&& reduce, size_t grain = 0) {
+  grain = parallel_detail::grain_of(count, grain);
+  auto partials = std::vector<std::optional<T>>((count + grain - 1) / grain);
+  parallel_scheduler().run(partials.size(), [&](size_t chunk) {
+    T acc = init;
+    for (size_t i = chunk * grain; i < std::min(count, (chunk + 1) * grain); ++i) {
+      acc = reduce(std::move(acc), map(i));
+    }
+    partials[chunk] = std::move(acc);
+  });
+  for (std::optional<T>& p : partials) {
+    init = reduce(std::move(init), std::move(*p));
+  }
+  return init;
+}
+
+// Profiling scopes, dumped as Chrome trace events by `run --trace`. Without AOS_TRACE, AOS_TRACE_SCOPE
+// expands to nothing; with it, a scope costs a relaxed load until tracing is started
+#if AOS_TRACE
+namespace trace {
+  inline std::atomic<bool> g_enabled{ false };
+
+  inline int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // `name` must outlive the dump, string literals and day names do
+  void record(const char* name, int64_t begin_ns, int64_t end_ns);
+
+  // Drops the events recorded so far and enables the scopes
+  void start();
+  void stop();
+
+  // Events since `start` as a Chrome trace-event JSON object, for chrome://tracing or Perfetto.
+  // Must not race with the recording threads
+  void write_json(std::ostream& out);
+
+  class scope_t {
+  public:
+    explicit scope_t(const char* name)
+      : m_name(name)
+      , m_begin(g_enabled.load(std::memory_order_relaxed) ? now_ns() : -1)
+    {}
+    scope_t(const scope_t&) = delete;
+    scope_t& operator=(const scope_t&) = delete;
+    ~scope_t() {
+      if (m_begin >= 0) {
+        record(m_name, m_begin, now_ns());
+      }
+    }
+
+  private:
+    const char* m_name;
+    int64_t m_begin;
+  };
+}
+
+#define AOS_TRACE_CONCAT_(a, b) a##b
+#define AOS_TRACE_CONCAT(a, b) AOS_TRACE_CONCAT_(a, b)
+#define AOS_TRACE_SCOPE(name) ::trace::scope_t AOS_TRACE_CONCAT(aos_trace_scope_, __LINE__){ name }
+#else
+#define AOS_TRACE_SCOPE(name) static_cast<void>(0)
+#endif
+
+
+// Random source for input generators. Unlike std distributions, its results only depend on the seed,
+// so that a seed gives the same input whatever the standard library
+class random_t {
+public:
+  explicit random_t(uint64_t seed)
+    : m_engine(seed)
+  {}
+
+  // In [0, n)
+  uint64_t below(uint64_t n) { return m_engine() % n; }
+
+  // In [lo, hi]
+  int64_t between(int64_t lo, int64_t hi) { return lo + static_cast<int64_t>(below(static_cast<uint64_t>(hi - lo) + 1)); }
+
+  bool chance(double p) { return static_cast<double>(m_engine() >> 11) * 0x1.0p-53 < p; }
+
+  char pick(std::string_view values) { return values[below(values.size())]; }
+
+  template<std::ranges::random_access_range R>
+    requires (!std::is_convertible_v<const R&, std::string_view>)
+  auto pick(const R& values) { return values[below(std::ranges::size(values))]; }
+
+  template<typename T>
+  void shuffle(std::span<T> values) {
+    for (size_t i = values.size(); i > 1; --i) {
+      std::swap(values[i - 1], values[below(i)]);
+    }
+  }
+
+private:
+  std::mt19937_64 m_engine;
+};
+
+// Side of a `dimensions`-dimensional input holding `scale` times the cells of one of side `base`
+inline size_t scaled_side(size_t base, size_t scale, int dimensions) {
+  return static_cast<size_t>(std::lround(static_cast<double>(base) * std::pow(static_cast<double>(scale), 1.0 / dimensions)));
+}
+
+// Shape of a grid2d: `width` x `height` inner cells, stored row by row in a single buffer and surrounded by a border
+// of `padding` cells on every side. Cells are addressed either by (x, y), inner ones in [0, width) x [0, height) and
+// border ones within `padding` of those, or by their index in the buffer, which neighbor offsets move between
+class grid2d_layout {
+public:
+  using index_t = std::ptrdiff_t;
+
+  grid2d_layout() = default;
+  grid2d_layout(size_t width, size_t height, size_t padding)
+    : m_width(width)
+    , m_height(height)
+    , m_padding(padding)
+  {}
+
+  size_t width() const { return m_width; }
+  size_t height() const { return m_height; }
+  size_t padding() const { return m_padding; }
+  index_t stride() const { return static_cast<index_t>(m_width + 2 * m_padding); }
+  size_t buffer_size() const { return (m_width + 2 * m_padding) * (m_height + 2 * m_padding); }
+
+  bool contains(index_t x, index_t y) const {
+    return x >= 0 && y >= 0 && x < static_cast<index_t>(m_width) && y < static_cast<index_t>(m_height);
+  }
+  bool contains_padded(index_t x, index_t y) const {
+    const auto p = static_cast<index_t>(m_padding);
+    return x >= -p && y >= -p && x < static_cast<index_t>(m_width) + p && y < static_cast<index_t>(m_height) + p;
+  }
+
+  index_t index_of(index_t x, index_t y) const {
+    assert(contains_padded(x, y));
+    const auto p = static_cast<index_t>(m_padding);
+    return (y + p) * stride() + x + p;
+  }
+  std::pair<index_t, index_t> pos_of(index_t i) const {
+    const auto p = static_cast<index_t>(m_padding);
+    return { i % stride() - p, i / stride() - p };
+  }
+
+  // Up, right, down and left
+  std::array<index_t, 4> neighbor_offsets() const { return { -stride(), 1, stride(), -1 }; }
+  // Clockwise from up, diagonals included
+  std::array<index_t, 8> neighbor_offsets8() const {
+    return { -stride(), -stride() + 1, 1, stride() + 1, stride(), stride() - 1, -1, -stride() - 1 };
+  }
+
+  // Calls `f` with the index of the 4 neighbors of the cell at `i`. Without a border, `i` must not be on an edge
+  template<typename F>
+  void for_each_neighbor(index_t i, F&& f) const {
+    for (index_t offset : neighbor_offsets()) {
+      f(i + offset);
+    }
+  }
+
+  auto operator<=>(const grid2d_layout&) const = default;
+
+private:
+  size_t m_width = 0;
+  size_t m_height = 0;
+  size_t m_padding = 0;
+};
+
+// Dense grid of `T`. Its border holds a sentinel, so that reading the neighbors of an inner cell needs no bounds check
+template<typename T>
+class grid2d : public grid2d_layout {
+public:
+  grid2d() = default;
+  grid2d(size_t width, size_t height, const T& value = T{}, size_t padding = 0, const T& border = T{})
+    : grid2d_layout(width, height, padding)
+    , m_cells(buffer_size(), border)
+  {
+    for (size_t y = 0; y < height; ++y) {
+      std::ranges::fill(row(y), value);
+    }
+  }
+
+  // `cell_of(c)` for every character of `lines`, those shorter than the longest one being completed with `fill`
+  template<typename Cell>
+  static grid2d from_lines(std::span<const std::string> lines, Cell&& cell_of, const T& fill = T{}, size_t padding = 0, const T& border = T{}) {
+    size_t width = 0;
+    for (const std::string& line : lines) {
+      width = std::max(width, line.size());
+    }
+    auto sent = grid2d(width, lines.size(), fill, padding, border);
+    for (size_t y = 0; y < lines.size(); ++y) {
+      std::ranges::transform(lines[y], sent.row(y).begin(), cell_of);
+    }
+    return sent;
+  }
+
+  T& operator()(index_t x, index_t y) { return m_cells[index_of(x, y)]; }
+  const T& operator()(index_t x, index_t y) const { return m_cells[index_of(x, y)]; }
+  T& operator[](index_t i) { return m_cells[i]; }
+  const T& operator[](index_t i) const { return m_cells[i]; }
+
+  // Inner cells of row `y`
+  std::span<T> row(index_t y) { return std::span(m_cells).subspan(index_of(0, y), width()); }
+  std::span<const T> row(index_t y) const { return std::span(m_cells).subspan(index_of(0, y), width()); }
+  // Every cell in buffer order, the border included
+  std::span<T> cells() { return m_cells; }
+  std::span<const T> cells() const { return m_cells; }
+
+  auto operator<=>(const grid2d&) const = default;
+
+private:
+  std::vector<T> m_cells;
+};
+
+// Bit-packed, with cells read by value and written with `set`
+template<>
+class grid2d<bool> : public grid2d_layout {
+public:
+  grid2d() = default;
+  grid2d(size_t width, size_t height, bool value = false, size_t padding = 0, bool border = false)
+    : grid2d_layout(width, height, padding)
+    , m_words((buffer_size() + 63) / 64)
+    , m_border(border)
+  {
+    if (border) {
+      for (index_t i = 0; i < static_cast<index_t>(buffer_size()); ++i) {
+        set(i, true);
+      }
+    }
+    if (value != border) {
+      for (index_t y = 0; y < static_cast<index_t>(height); ++y) {
+        for (index_t x = 0; x < static_cast<index_t>(width); ++x) {
+          set(x, y, value);
+        }
+      }
+    }
+  }
+
+  bool operator()(index_t x, index_t y) const { return (*this)[index_of(x, y)]; }
+  bool operator[](index_t i) const { return (m_words[i / 64] >> (i % 64)) & 1; }
+
+  void set(index_t x, index_t y, bool value) { set(index_of(x, y), value); }
+  void set(index_t i, bool value) {
+    const uint64_t bit = uint64_t{ 1 } << (i % 64);
+    m_words[i / 64] = value ? m_words[i / 64] | bit : m_words[i / 64] & ~bit;
+  }
+
+  // Of the inner cells, those set
+  size_t count() const {
+    size_t sent = 0;
+    for (uint64_t word : m_words) {
+      sent += std::popcount(word);
+    }
+    return m_border ? sent - (buffer_size() - width() * height()) : sent;
+  }
+
+  auto operator<=>(const grid2d&) const = default;
+
+private:
+  std::vector<uint64_t> m_words;
+  bool m_border = false;
+};
+
+// Breadth-first search over states numbered densely in [0, state_count). The visited bitmap and the two frontiers,
+// swapped at every layer, belong to the engine: searching again in a space no larger than before allocates nothing
+class bfs_engine {
+public:
+  using state_t = size_t;
+
+  // `each_layer` forgets the visited states at every layer, for searches in time where waiting is a move
+  enum class revisit {
+    never,
+    each_layer
+  };
+
+  struct no_hook {
+    void operator()(size_t) const {}
+  };
+
+  // Depth of the first state satisfying `is_goal`, the `sources` being at depth 0, or nullopt when none is reachable.
+  // `neighbors(state, emit)` calls `emit(next)` for every state one step away from `state`, and `on_layer(depth)` is
+  // called before reaching the states at `depth`
+  template<typename Neighbors, std::predicate<state_t> IsGoal, typename OnLayer = no_hook>
+  std::optional<size_t> search(size_t state_count, std::span<const state_t> sources, Neighbors&& neighbors, IsGoal&& is_goal,
+    revisit mode = revisit::never, OnLayer&& on_layer = {}) {
+    return walk(state_count, sources, neighbors, [&](state_t s, size_t) { return is_goal(s); }, mode, on_layer);
+  }
+
+  // Calls `visit(state, depth)` once for every state reachable from `sources`
+  template<typename Neighbors, typename Visit>
+  void flood(size_t state_count, std::span<const state_t> sources, Neighbors&& neighbors, Visit&& visit) {
+    walk(state_count, sources, neighbors, [&](state_t s, size_t depth) { visit(s, depth); return false; }, revisit::never, no_hook{});
+  }
+
+  // The states of the last layer reached, while searching those at `depth - 1` from `on_layer(depth)`
+  std::span<const state_t> frontier() const { return m_frontier; }
+
+private:
+  bool mark(state_t s) {
+    const uint64_t bit = uint64_t{ 1 } << (s % 64);
+    uint64_t& word = m_visited[s / 64];
+    const bool sent = (word & bit) == 0;
+    word |= bit;
+    return sent;
+  }
+
+  template<typename Neighbors, typename Stop, typename OnLayer>
+  std::optional<size_t> walk(size_t state_count, std::span<const state_t> sources, Neighbors& neighbors, Stop&& stop,
+    revisit mode, OnLayer&& on_layer) {
+    m_visited.assign((state_count + 63) / 64, 0);
+    m_frontier.clear();
+    m_next.clear();
+    for (state_t s : sources) {
+      assert(s < state_count);
+      if (mark(s)) {
+        if (stop(s, 0)) {
+          return 0;
+        }
+        m_frontier.push_back(s);
+      }
+    }
+    for (size_t depth = 1; !m_frontier.empty(); ++depth) {
+      on_layer(depth);
+      if (mode == revisit::each_layer) {
+        std::ranges::fill(m_visited, 0);
+      }
+      bool found = false;
+      auto emit = [&](state_t next) {
+        assert(next < state_count);
+        if (!found && mark(next)) {
+          found = stop(next, depth);
+          m_next.push_back(next);
+        }
+      };
+      for (state_t cur : m_frontier) {
+        neighbors(cur, emit);
+        if (found) {
+          return depth;
+        }
+      }
+      std::swap(m_frontier, m_next);
+      m_next.clear();
+    }
+    return std::nullopt;
+  }
+
+  std::vector<uint64_t> m_visited;
+  std::vector<state_t> m_frontier;
+  std::vector<state_t> m_next;
+};
+
+// Finalizer of MurmurHash3, so that every bit of `h` reaches every bit of the result
+constexpr uint64_t mix64(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// Small coordinates packed in the 64 bits keys of the flat hash containers: 32 bits per axis in 2D, 21 in 3D
+constexpr uint64_t pack_coords(int64_t x, int64_t y) {
+  return (static_cast<uint64_t>(x) << 32) | static_cast<uint32_t>(y);
+}
+
+constexpr uint64_t pack_coords(int64_t x, int64_t y, int64_t z) {
+  constexpr uint64_t mask = (uint64_t{ 1 } << 21) - 1;
+  return ((static_cast<uint64_t>(x) & mask) << 42) | ((static_cast<uint64_t>(y) & mask) << 21) | (static_cast<uint64_t>(z) & mask);
+}
+
+// Keys of the flat hash containers provide `uint64_t pack_key(const Key&)`, found by ADL, equal for equal keys
+template<typename Key>
+concept packable_key = std::equality_comparable<Key> && std::default_initializable<Key> && requires(const Key& key) {
+  { pack_key(key) } -> std::convertible_to<uint64_t>;
+};
+
+namespace flat_hash_detail {
+  // Open addressing with linear probing, by groups of 16 slots whose control bytes are matched at once. A control
+  // byte holds 7 bits of the hash of a full slot, or is negative for empty and erased slots
+  template<packable_key Key, typename Slot>
+  class table {
+    static constexpr int8_t empty_slot = -128;
+    static constexpr int8_t erased_slot = -2;
+    static constexpr size_t group_size = 16;
+    static constexpr size_t not_found = std::numeric_limits<size_t>::max();
+
+  public:
+    template<bool Const>
+    class iterator_t {
+    public:
+      using iterator_concept = std::forward_iterator_tag;
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Slot;
+      using difference_type = std::ptrdiff_t;
+      using reference = std::conditional_t<Const, const Slot&, Slot&>;
+      using pointer = std::conditional_t<Const, const Slot*, Slot*>;
+      using table_t = std::conditional_t<Const, const table, table>;
+
+      iterator_t() = default;
+      iterator_t(table_t* t, size_t i)
+        : m_table(t)
+        , m_index(i)
+      {
+        skip_free();
+      }
+      operator iterator_t<true>() const requires (!Const) { return { m_table, m_index }; }
+
+      reference operator*() const { return m_table->m_slots[m_index]; }
+      pointer operator->() const { return &m_table->m_slots[m_index]; }
+      iterator_t& operator++() {
+        ++m_index;
+        skip_free();
+        return *this;
+      }
+      iterator_t operator++(int) {
+        auto sent = *this;
+        ++*this;
+        return sent;
+      }
+      bool operator==(const iterator_t& r) const { return m_index == r.m_index; }
+
+    private:
+      void skip_free() {
+        while (m_index < m_table->m_control.size() && m_table->m_control[m_index] < 0) {
+          ++m_index;
+        }
+      }
+
+      table_t* m_table = nullptr;
+      size_t m_index = 0;
+    };
+
+    using key_type = Key;
+    using value_type = Slot;
+    using iterator = iterator_t<false>;
+    using const_iterator = iterator_t<true>;
+
+    explicit table(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : m_control(memory)
+      , m_slots(memory)
+    {}
+    table(const table& other, std::pmr::memory_resource* memory)
+      : m_control(other.m_control, memory)
+      , m_slots(other.m_slots, memory)
+      , m_size(other.m_size)
+      , m_used(other.m_used)
+    {}
+    table(std::initializer_list<Slot> slots, std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+      : table(memory)
+    {
+      for (const Slot& s : slots) {
+        m_slots[insert_index(key_of(s)).first] = s;
+      }
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t capacity() const { return m_slots.size(); }
+    std::pmr::polymorphic_allocator<> get_allocator() const { return m_slots.get_allocator(); }
+
+    iterator begin() { return { this, 0 }; }
+    iterator end() { return { this, capacity() }; }
+    const_iterator begin() const { return { this, 0 }; }
+    const_iterator end() const { return { this, capacity() }; }
+
+    bool contains(const Key& key) const { return find_index(key, hash_of(key)) != not_found; }
+
+    iterator find(const Key& key) {
+      const size_t found = find_index(key, hash_of(key));
+      return { this, found == not_found ? capacity() : found };
+    }
+    const_iterator find(const Key& key) const {
+      const size_t found = find_index(key, hash_of(key));
+      return { this, found == not_found ? capacity() : found };
+    }
+
+    size_t erase(const Key& key) {
+      const size_t found = find_index(key, hash_of(key));
+      if (found == not_found) {
+        return 0;
+      }
+      m_control[found] = erased_slot;
+      m_slots[found] = Slot{};
+      --m_size;
+      return 1;
+    }
+
+    void clear() {
+      std::ranges::fill(m_control, empty_slot);
+      std::ranges::fill(m_slots, Slot{});
+      m_size = 0;
+      m_used = 0;
+    }
+
+    // Room for `count` keys without growing
+    void reserve(size_t count) {
+      if (count > capacity() / 8 * 7) {
+        rehash(std::bit_ceil(std::max(group_size, count * 8 / 7 + 1)));
+      }
+    }
+
+    // Same keys, whatever their order
+    bool operator==(const table& r) const {
+      return m_size == r.m_size && std::ranges::all_of(*this, [&r](const Slot& s) {
+        const auto found = r.find(key_of(s));
+        return found != r.end() && *found == s;
+      });
+    }
+
+  protected:
+    static const Key& key_of(const Slot& s) {
+      if constexpr (std::is_same_v<Slot, Key>) {
+        return s;
+      } else {
+        return s.first;
+      }
+    }
+
+    // Index of the slot of `key`, and whether it was just added with a default value
+    std::pair<size_t, bool> insert_index(const Key& key) {
+      uint64_t hash = hash_of(key);
+      if (const size_t found = find_index(key, hash); found != not_found) {
+        return { found, false };
+      }
+      if (m_used + 1 > capacity() / 8 * 7) {
+        // Erased slots are dropped by rehashing, which only grows when they were few
+        rehash(std::max(group_size, std::bit_ceil((m_size + 1) * 2)));
+      }
+      const size_t mask = capacity() - 1;
+      for (size_t group = hash & mask & ~(group_size - 1); true; group = (group + group_size) & mask) {
+        if (const uint32_t free = simd::sign_mask16(&m_control[group]); free != 0) {
+          const size_t i = group + std::countr_zero(free);
+          m_used += m_control[i] == empty_slot;
+          m_control[i] = control_of(hash);
+          if constexpr (std::is_same_v<Slot, Key>) {
+            m_slots[i] = key;
+          } else {
+            m_slots[i] = Slot{ key, {} };
+          }
+          ++m_size;
+          return { i, true };
+        }
+      }
+    }
+
+    std::pmr::vector<int8_t> m_control;
+    std::pmr::vector<Slot> m_slots;
+
+  private:
+    // Every bit of the coordinates reaches the bits used for probing
+    static uint64_t hash_of(const Key& key) {
+      return mix64(pack_key(key));
+    }
+
+    static int8_t control_of(uint64_t hash) {
+      return static_cast<int8_t>(hash >> 57);
+    }
+
+    size_t find_index(const Key& key, uint64_t hash) const {
+      if (m_size == 0) {
+        return not_found;
+      }
+      const size_t mask = capacity() - 1;
+      const int8_t control = control_of(hash);
+      for (size_t group = hash & mask & ~(group_size - 1); true; group = (group + group_size) & mask) {
+        const int8_t* bytes = &m_control[group];
+        for (uint32_t matches = simd::match_mask16(bytes, control); matches != 0; matches &= matches - 1) {
+          const size_t i = group + std::countr_zero(matches);
+          if (key_of(m_slots[i]) == key) {
+            return i;
+          }
+        }
+        if (simd::match_mask16(bytes, empty_slot) != 0) {
+          return not_found;
+        }
+      }
+    }
+
+    void rehash(size_t new_capacity) {
+      auto control = std::exchange(m_control, std::pmr::vector<int8_t>(new_capacity, empty_slot, m_control.get_allocator()));
+      auto slots = std::exchange(m_slots, std::pmr::vector<Slot>(new_capacity, m_slots.get_allocator()));
+      m_size = 0;
+      m_used = 0;
+      for (size_t i = 0; i < control.size(); ++i) {
+        if (control[i] >= 0) {
+          m_slots[insert_index(key_of(slots[i])).first] = std::move(slots[i]);
+        }
+      }
+    }
+
+    size_t m_size = 0;
+    // Full and erased slots, which both lengthen the probes
+    size_t m_used = 0;
+  };
+}
+
+// Flat hash set of small coordinates, see flat_hash_detail::table
+template<packable_key Key>
+class flat_hash_set : public flat_hash_detail::table<Key, Key> {
+  using base = flat_hash_detail::table<Key, Key>;
+
+public:
+  using base::base;
+
+  std::pair<typename base::iterator, bool> insert(const Key& key) {
+    auto [i, inserted] = this->insert_index(key);
+    return { typename base::iterator(this, i), inserted };
+  }
+};
+
+// Flat hash map of small coordinates, see flat_hash_detail::table
+template<packable_key Key, typename Value>
+class flat_hash_map : public flat_hash_detail::table<Key, std::pair<Key, Value>> {
+  using base = flat_hash_detail::table<Key, std::pair<Key, Value>>;
+
+public:
+  using base::base;
+  using mapped_type = Value;
+
+  template<typename... Args>
+  std::pair<typename base::iterator, bool> try_emplace(const Key& key, Args&&... args) {
+    auto [i, inserted] = this->insert_index(key);
+    if (inserted) {
+      this->m_slots[i].second = Value(std::forward<Args>(args)...);
+    }
+    return { typename base::iterator(this, i), inserted };
+  }
+
+  std::pair<typename base::iterator, bool> insert(const std::pair<Key, Value>& slot) {
+    return try_emplace(slot.first, slot.second);
+  }
+
+  Value& operator[](const Key& key) {
+    return this->m_slots[this->insert_index(key).first].second;
+  }
+
+  const Value& at(const Key& key) const {
+    const auto found = this->find(key);
+    if (found == this->end()) {
+      throw std::out_of_range("flat_hash_map::at");
+    }
+    return found->second;
+  }
+};
+
+// Where a sequence of states starts repeating: the state at step `start + period` is the one at step `start`
+struct cycle_t {
+  size_t start = 0;
+  size_t period = 0;
+
+  // Step before `start + period` in the same state as `step`
+  size_t fold(size_t step) const {
+    return step < start ? step : start + (step - start) % period;
+  }
+
+  // Value at `step` of a quantity growing by the same amount every period, like the height of a pile, from its values
+  // `value_at(s)` for s up to `start + period`
+  template<typename F>
+  auto extrapolate(size_t step, F&& value_at) const {
+    using value_t = decltype(value_at(step));
+    if (step < start + period) {
+      return value_at(step);
+    }
+    const auto periods = static_cast<value_t>((step - start) / period);
+    return value_at(fold(step)) + periods * (value_at(start + period) - value_at(start));
+  }
+
+  auto operator<=>(const cycle_t&) const = default;
+};
+
+// 64 bits hash of a state, built from its parts
+class fingerprint_t {
+public:
+  fingerprint_t& add(uint64_t v) {
+    m_hash = mix64(m_hash ^ (v + 0x9e3779b97f4a7c15ULL));
+    return *this;
+  }
+
+  fingerprint_t& add(std::span<const uint8_t> bytes) {
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+      uint64_t word;
+      std::memcpy(&word, bytes.data() + i, 8);
+      add(word);
+    }
+    uint64_t tail = bytes.size();
+    for (; i < bytes.size(); ++i) {
+      tail = (tail << 8) | bytes[i];
+    }
+    return add(tail);
+  }
+
+  uint64_t value() const { return m_hash; }
+
+private:
+  uint64_t m_hash = 0;
+};
+
+namespace cycle_detail {
+  struct key_t {
+    uint64_t fingerprint = 0;
+
+    bool operator==(const key_t&) const = default;
+    friend uint64_t pack_key(const key_t& k) { return k.fingerprint; }
+  };
+}
+
+// Detects when a simulation gets back to a state it was in, from the fingerprint of the state of each step. States are
+// kept by the caller, and compared in full only for steps whose fingerprints are equal
+class cycle_detector {
+public:
+  // Adds the next step, the first being 0, with the fingerprint of its state. `same_state(earlier)` tells whether the
+  // state of the step `earlier` is the one of this step
+  template<std::predicate<size_t> SameState>
+  std::optional<cycle_t> add(uint64_t fingerprint, SameState&& same_state) {
+    const size_t step = m_previous.size();
+    auto [slot, inserted] = m_last.try_emplace(cycle_detail::key_t{ fingerprint }, step);
+    size_t earlier = not_found;
+    if (!inserted) {
+      for (earlier = slot->second; earlier != not_found; earlier = m_previous[earlier]) {
+        if (same_state(earlier)) {
+          return cycle_t{ .start = earlier, .period = step - earlier };
+        }
+      }
+      // Fingerprints collided, the steps sharing one are chained from the last
+      earlier = std::exchange(slot->second, step);
+    }
+    m_previous.push_back(earlier);
+    return std::nullopt;
+  }
+
+  size_t steps() const { return m_previous.size(); }
+
+private:
+  static constexpr size_t not_found = std::numeric_limits<size_t>::max();
+
+  // Last step of each fingerprint
+  flat_hash_map<cycle_detail::key_t, size_t> m_last;
+  // Of each step, the previous one with the same fingerprint
+  std::vector<size_t> m_previous;
+};
+
+enum class cycle_search {
+  brent,
+  floyd
+};
+
+// Cycle of the states reached from `initial` by `step(state)`, which advances a state in place, comparing them with
+// ==. Neither mode keeps the states seen, for states cheaper to regenerate than to record; Brent's usually steps less
+template<typename State, typename Step>
+cycle_t find_cycle(const State& initial, Step&& step, cycle_search mode = cycle_search::brent) {
+  auto sent = cycle_t{};
+  State tortoise = initial;
+  State hare = initial;
+  if (mode == cycle_search::brent) {
+    // The tortoise waits at powers of two for the hare to come back to it
+    step(hare);
+    sent.period = 1;
+    for (size_t power = 1; tortoise != hare; ++sent.period) {
+      if (power == sent.period) {
+        tortoise = hare;
+        power *= 2;
+        sent.period = 0;
+      }
+      step(hare);
+    }
+    tortoise = initial;
+    hare = initial;
+    for (size_t i = 0; i < sent.period; ++i) {
+      step(hare);
+    }
+  } else {
+    // The hare, twice as fast, meets the tortoise at a multiple of the period
+    do {
+      step(tortoise);
+      step(hare);
+      step(hare);
+    } while (tortoise != hare);
+    tortoise = initial;
+  }
+  // One period apart, they first meet at the start of the cycle
+  for (; tortoise != hare; ++sent.start) {
+    step(tortoise);
+    step(hare);
+  }
+  if (mode == cycle_search::floyd) {
+    hare = tortoise;
+    step(hare);
+    for (sent.period = 1; tortoise != hare; ++sent.period) {
+      step(hare);
+    }
+  }
+  return sent;
+}